@@ -0,0 +1,2061 @@
+/*
+
+  Timing harness for the planner
+
+  This is not part of the robot program and doesn't need saphira.
+  Build it with "make bench" and run
+
+    bench [test ...]
+
+  With no arguments every test is run. Generated maps are written to the
+  current directory and removed afterwards.
+*/
+
+#include "world.h"
+#include "general.h"
+#include "workerpool.h"
+#include "edgetable.h"
+#include "footprint.h"
+#include "growcache.h"
+#include "rotsweep.h"
+#include "edgegrid.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+using std::cout;
+using std::endl;
+
+//////////////////////////////////////////////////////////////////// HELPERS
+
+//! Wall clock stopwatch
+class Timer
+{
+public:
+  Timer() { restart(); }
+
+  void restart()
+  {
+    begin = std::chrono::steady_clock::now();
+  }
+
+  //! seconds since construction or the last restart
+  double elapsed() const
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point begin;
+};
+
+/*! Hardware cache miss counter for the calling thread
+
+   Uses perf_event_open on linux. available() is false where the kernel
+   or the virtual machine doesn't expose the counter, and elsewhere.
+*/
+class CacheMisses
+{
+public:
+  CacheMisses() : fd(-1)
+  {
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+
+  ~CacheMisses()
+  {
+#ifdef __linux__
+    if (fd >= 0) close(fd);
+#endif
+  }
+
+  bool available() const
+  {
+    return fd >= 0;
+  }
+
+  void start()
+  {
+#ifdef __linux__
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  //! misses since start(), -1 if there is no counter
+  long long stop()
+  {
+    long long count = -1;
+#ifdef __linux__
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+      count = -1;
+#endif
+    return count;
+  }
+
+private:
+  int fd;
+};
+
+//! Repetitions that keep a test on n items near a million items total
+int repetitions(long n)
+{
+  long r = 1000000 / n;
+  return r < 1 ? 1 : (r > 100 ? 100 : (int)r);
+}
+
+/*! Write an obstacle file with about n vertices
+
+   The obstacles are 400mm squares on a 1000mm grid, written in the same
+   layout as obstacle.txt with the first vertex repeated to close each
+   shape.
+*/
+void writeSquares(char const * filename, long n)
+{
+  CFile fp(filename, "w");
+  long shapes = (n + 3) / 4;
+  long columns = 1;
+  while (columns * columns < shapes) ++columns;
+
+  for(long s = 0; s < shapes; ++s)
+  {
+    long x = (s % columns) * 1000;
+    long y = (s / columns) * 1000;
+    fprintf(fp, "%li %li\n%li %li\n%li %li\n%li %li\n%li %li\n\n",
+      x, y, x + 400, y, x + 400, y + 400, x, y + 400, x, y);
+  }
+}
+
+/*! Fill world with a map of about n obstacle vertices, ready for growShapes
+
+   Squares of 400mm sit on a jittered 1500mm grid, far enough apart that
+   they don't overlap once grown. The start area is below the bottom left
+   corner of the grid and the goal area above the top right.
+*/
+void makeWorld(World & world, long n)
+{
+  typedef World::WPoint WPoint;
+
+  world.vertices.resize(0);
+  world.shapes.resize(0);
+  long shapes = (n + 3) / 4;
+  long columns = 1;
+  while (columns * columns < shapes) ++columns;
+
+  for(long s = 0; s < shapes; ++s)
+  {
+    int x = (s % columns) * 1500 + (s * 7919) % 300;
+    int y = (s / columns) * 1500 + (s * 104729) % 300;
+    WPoint square[] = { WPoint(x, y), WPoint(x + 400, y), WPoint(x + 400, y + 400), WPoint(x, y + 400) };
+    world.shapes.push_back(World::Shape(world.vertices.size(), DIM(square)));
+    for(int v = 0; v < DIM(square); ++v)
+      world.vertices.push_back(World::Vertex(square[v], s));
+  }
+
+  int top = ((shapes - 1) / columns + 1) * 1500;
+  int right = columns * 1500;
+  WPoint start[] = { WPoint(-1200, -1200), WPoint(-1000, -1200), WPoint(-1000, -1000), WPoint(-1200, -1000) };
+  WPoint goal[] = { WPoint(right, top), WPoint(right + 200, top), WPoint(right + 200, top + 200), WPoint(right, top + 200) };
+  world.startarea.assign(start, start + DIM(start));
+  world.goalarea.assign(goal, goal + DIM(goal));
+  world.start = world.goal = World::GVertex();
+}
+
+long fileSize(char const * filename)
+{
+  CFile fp(filename, "r");
+  fseek(fp, 0, SEEK_END);
+  return ftell(fp);
+}
+
+////////////////////////////////////////////////////////////////////// TESTS
+
+//! Obstacle file parsing throughput, mapped file vs stdio stream
+void bench_parse()
+{
+  char const * MAP = "bench_map.txt";
+  long sizes[] = { 1000, 10000, 100000, 1000000, 10000000 };
+
+  cout << "vertices\tbytes\tmmap MB/s\tmmap vertices/s\tstdio MB/s\tstdio vertices/s" << endl;
+
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    writeSquares(MAP, sizes[i]);
+    double bytes = fileSize(MAP);
+    int reps = repetitions(sizes[i]);
+
+    World world;
+    double vertices = 0;
+
+    Timer t;
+    for(int r = 0; r < reps; ++r)
+      world.readFile(MAP, world.vertices, &world.shapes);
+    double mapped = t.elapsed() / reps;
+    vertices = world.vertices.size();
+
+    t.restart();
+    for(int r = 0; r < reps; ++r)
+    {
+      CFile fp(MAP, "r");
+      world.readFile(fp, world.vertices, &world.shapes);
+    }
+    double streamed = t.elapsed() / reps;
+
+    cout << (long)vertices << '\t' << (long)bytes << '\t'
+         << bytes / mapped / 1e6 << '\t' << vertices / mapped << '\t'
+         << bytes / streamed / 1e6 << '\t' << vertices / streamed << endl;
+  }
+  remove(MAP);
+}
+
+//! the fprintf version of World::outputVisibility, for comparison
+void printfVisibility(World & world, FILE * fp)
+{
+  for(int i = 0; i < world.isvisible.size(); ++i)
+  for(int j = 0; j < i; ++j)
+  {
+    if (world.isvisible(i,j))
+    {
+      World::GVertex I = world.get_node(i);
+      World::GVertex J = world.get_node(j);
+      fprintf(fp, "%i %i # shape %i, vertex %i\n"  , I.x, I.y, I.shapeno, world.nodes[i]);
+      fprintf(fp, "%i %i # shape %i, vertex %i\n\n", J.x, J.y, J.shapeno, world.nodes[j]);
+    }
+  }
+}
+
+//! Visibility graph output throughput, fprintf vs buffered text vs binary
+void bench_output()
+{
+  char const * OUT = "bench_out.txt";
+  int sizes[] = { 500, 1000, 2000, 4000 };
+
+  cout << "nodes\tedges\tfprintf MB/s\ttext MB/s\tbinary MB/s\tfprintf s\ttext s\tbinary s" << endl;
+
+  for(int s = 0; s < DIM(sizes); ++s)
+  {
+    // a synthetic graph, every third pair of nodes can see each other
+    int n = sizes[s];
+    World world;
+    world.gvertices.resize(n - 2);
+    world.nodes.push_back(World::START);
+    for(int i = 0; i < n - 2; ++i)
+    {
+      world.gvertices[i] = World::GVertex(World::WPoint(i * 37 % 20000, i * 91 % 20000), i / 4, i);
+      world.nodes.push_back(i);
+    }
+    world.nodes.push_back(World::GOAL);
+    world.isvisible.resize(n);
+    long edges = 0;
+    for(int i = 0; i < n; ++i)
+    for(int j = 0; j <= i; ++j)
+    {
+      world.isvisible(i,j) = j < i && (i + j) % 3 == 0;
+      if (world.isvisible(i,j)) ++edges;
+    }
+
+    Timer t;
+    {
+      CFile fp(OUT, "w");
+      printfVisibility(world, fp);
+    }
+    double printeds = t.elapsed();
+    double printed = fileSize(OUT) / printeds / 1e6;
+
+    t.restart();
+    {
+      CFile fp(OUT, "w");
+      world.outputVisibility(fp);
+    }
+    double texts = t.elapsed();
+    double text = fileSize(OUT) / texts / 1e6;
+
+    t.restart();
+    {
+      CFile fp(OUT, "wb");
+      world.outputVisibilityBinary(fp);
+    }
+    double binarys = t.elapsed();
+    double binary = fileSize(OUT) / binarys / 1e6;
+
+    cout << n << '\t' << edges << '\t' << printed << '\t' << text << '\t'
+         << binary << '\t' << printeds << '\t' << texts << '\t' << binarys << endl;
+  }
+  remove(OUT);
+}
+
+//! thread counts to try: powers of two up to the number of hardware threads
+vector<int> threadCounts()
+{
+  int most = std::thread::hardware_concurrency();
+  vector<int> counts;
+  for(int t = 1; t < most; t *= 2)
+    counts.push_back(t);
+  counts.push_back(most > 1 ? most : 1);
+  return counts;
+}
+
+//! Parallel obstacle file parsing, speedup over the serial parser
+void bench_pparse()
+{
+  char const * MAP = "bench_map.txt";
+  long VERTICES = 10000000;
+
+  writeSquares(MAP, VERTICES);
+  double bytes = fileSize(MAP);
+
+  World world;
+  Timer t;
+  world.readFile(MAP, world.vertices, &world.shapes);
+  double serial = t.elapsed();
+
+  cout << "threads\tMB/s\tvertices/s\tspeedup" << endl;
+  cout << "serial\t" << bytes / serial / 1e6 << '\t' << world.vertices.size() / serial << "\t1" << endl;
+
+  vector<int> counts = threadCounts();
+  for(size_t c = 0; c < counts.size(); ++c)
+  {
+    WorkerPool pool(counts[c]);
+    world.workers = &pool;
+    t.restart();
+    world.readFile(MAP, world.vertices, &world.shapes);
+    double seconds = t.elapsed();
+    world.workers = NULL;
+
+    cout << counts[c] << '\t' << bytes / seconds / 1e6 << '\t'
+         << world.vertices.size() / seconds << '\t' << serial / seconds << endl;
+  }
+  remove(MAP);
+}
+
+//! the division based orientation test that line_rside replaced, for comparison
+int divisionRside(World::WPoint R, World::WPoint P, World::WPoint Q)
+{
+  typedef World::WPoint WPoint;
+  int r;
+  if(P.y == Q.y)
+    r = R.y < P.y ? WPoint::RIGHT_SIDE : R.y > P.y ? WPoint::LEFT_SIDE
+      : R.x == P.x ? WPoint::LEFT_SIDE | WPoint::RIGHT_SIDE : 0;
+  else
+  {
+    int x = P.x == Q.x ? P.x : P.x + (Q.x-P.x) * (R.y-P.y) / (Q.y-P.y);
+    r = R.x < x ? WPoint::LEFT_SIDE : R.x > x ? WPoint::RIGHT_SIDE : WPoint::LEFT_SIDE | WPoint::RIGHT_SIDE;
+  }
+  if ((P.y > Q.y || (P.y == Q.y && P.x > Q.x)) && (r == WPoint::LEFT_SIDE || r == WPoint::RIGHT_SIDE))
+    r ^= WPoint::LEFT_SIDE | WPoint::RIGHT_SIDE;
+  return r;
+}
+
+bool divisionIntersect(World::WPoint P1, World::WPoint Q1, World::WPoint P2, World::WPoint Q2)
+{
+  return !(divisionRside(P2, P1, Q1) & divisionRside(Q2, P1, Q1) || divisionRside(P1, P2, Q2) & divisionRside(Q1, P2, Q2));
+}
+
+//! the makeVisibility edge test loop with a given intersection test, returns the number of visible pairs
+template<class Intersect>
+long visibilityLoop(World & world, Intersect intersect)
+{
+  long visible = 0;
+  for(size_t p = 0; p < world.gvertices.size(); ++p)
+  for(size_t q = 0; q < p; ++q)
+  {
+    World::GVertex const & P = world.gvertices[p];
+    World::GVertex const & Q = world.gvertices[q];
+    bool blocked = false;
+    for(size_t s = 0; s < world.gshapes.size() && !blocked; ++s)
+    {
+      int sv = world.gshapes[s].startidx;
+      int nv = world.gshapes[s].vertices;
+      for(int e = 0; e < nv && !blocked; ++e)
+        blocked = intersect(P, Q, world.gvertices[sv + e], world.gvertices[sv + (e + 1) % nv]);
+    }
+    visible += !blocked;
+  }
+  return visible;
+}
+
+//! Orientation test cost per call and per visibility build, division vs cross product
+void bench_orient()
+{
+  typedef World::WPoint WPoint;
+  const int N = 1 << 16;
+  const int REPS = 100;
+
+  vector<WPoint> points(N);
+  unsigned seed = 12345;
+  for(int i = 0; i < N; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    int x = (seed >> 8) % 20000;
+    seed = seed * 1103515245 + 12345;
+    points[i] = WPoint(x, (seed >> 8) % 20000);
+  }
+
+  long sum = 0;
+  Timer t;
+  for(int r = 0; r < REPS; ++r)
+  for(int i = 0; i < N; ++i)
+    sum += divisionRside(points[i], points[(i + 1) & (N - 1)], points[(i + 2) & (N - 1)]);
+  double division = t.elapsed() / REPS / N * 1e9;
+
+  t.restart();
+  for(int r = 0; r < REPS; ++r)
+  for(int i = 0; i < N; ++i)
+    sum -= points[i].line_rside(points[(i + 1) & (N - 1)], points[(i + 2) & (N - 1)]);
+  double cross = t.elapsed() / REPS / N * 1e9;
+
+  cout << "per call\tdivision ns\tcross product ns\tspeedup\t(checksum " << sum << ")" << endl;
+  cout << "line_rside\t" << division << '\t' << cross << '\t' << division / cross << endl;
+  cout << endl;
+
+  long sizes[] = { 100, 200, 400, 800 };
+  cout << "vertices\tdivision s\tcross product s\tspeedup\tvisible pairs" << endl;
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    World world;
+    makeWorld(world, sizes[i]);
+    world.growShapes(1.0);
+
+    t.restart();
+    long a = visibilityLoop(world, divisionIntersect);
+    double division = t.elapsed();
+
+    t.restart();
+    long b = visibilityLoop(world, linesIntersect<World::coord>);
+    double cross = t.elapsed();
+
+    cout << world.gvertices.size() << '\t' << division << '\t' << cross << '\t'
+         << division / cross << '\t' << a << " / " << b << endl;
+  }
+}
+
+//! the original visibility test, walking the shapes with modular edge indices
+bool shapesIntersect(World & world, World::WPoint P, World::WPoint Q)
+{
+  for(size_t s = 0; s < world.gshapes.size(); ++s)
+  {
+    int sv = world.gshapes[s].startidx;
+    int nv = world.gshapes[s].vertices;
+    for(int e = sv; e < sv + nv; ++e)
+      if (linesIntersect(P, Q, world.gvertices[e], world.gvertices[(e-sv+1)%nv + sv]))
+        return true;
+  }
+  return false;
+}
+
+//! Segment against all edges: shape loop vs flat edge table, scalar, AVX2 and hull search
+void bench_edges()
+{
+  typedef World::WPoint WPoint;
+  const int QUERIES = 2000;
+
+  cout << "kernel available: " << (EdgeTable::bestKernel() == EdgeTable::AVX2 ? "avx2" : "scalar") << endl;
+  cout << "edges\tshape loop us\ttable scalar us\ttable avx2 us\thull search us\tblocked" << endl;
+
+  long sizes[] = { 1000, 5000, 20000, 50000 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    World world;
+    makeWorld(world, sizes[i]);
+    world.growShapes(1.0);
+
+    EdgeTable edges;
+    edges.assign(world.gvertices, world.gshapes);
+
+    // random segments between grown vertices, plus short ones that cross nothing
+    vector<WPoint> from, to;
+    unsigned seed = 54321;
+    for(int q = 0; q < QUERIES; ++q)
+    {
+      seed = seed * 1103515245 + 12345;
+      World::GVertex const & P = world.gvertices[(seed >> 8) % world.gvertices.size()];
+      seed = seed * 1103515245 + 12345;
+      World::GVertex const & Q = world.gvertices[(seed >> 8) % world.gvertices.size()];
+      from.push_back(P);
+      to.push_back(q % 2 ? (WPoint)Q : WPoint(P.x + 50, P.y - 50 + (seed >> 8) % 100));
+    }
+
+    Timer t;
+    long a = 0;
+    for(int q = 0; q < QUERIES; ++q)
+      a += shapesIntersect(world, from[q], to[q]);
+    double loop = t.elapsed() / QUERIES * 1e6;
+
+    edges.setKernel(EdgeTable::SCALAR);
+    t.restart();
+    long b = 0;
+    for(int q = 0; q < QUERIES; ++q)
+      b += edges.intersects(from[q], to[q]);
+    double scalar = t.elapsed() / QUERIES * 1e6;
+
+    edges.setKernel(EdgeTable::AVX2);
+    t.restart();
+    long c = 0;
+    for(int q = 0; q < QUERIES; ++q)
+      c += edges.intersects(from[q], to[q]);
+    double avx2 = t.elapsed() / QUERIES * 1e6;
+
+    edges.setKernel(EdgeTable::HULLS);
+    t.restart();
+    long d = 0;
+    for(int q = 0; q < QUERIES; ++q)
+      d += edges.intersects(from[q], to[q]);
+    double hulls = t.elapsed() / QUERIES * 1e6;
+
+    if (a != b || a != c || a != d)
+      BARF("Edge table results differ from the shape loop");
+
+    cout << edges.size() << '\t' << loop << '\t' << scalar << '\t' << avx2 << '\t'
+         << hulls << '\t' << a << endl;
+  }
+}
+
+//! makeVisibility's pair loop as it was, going through get_node and the shape array
+void aosVisibility(World & world)
+{
+  int gpl = world.nodes.size();
+  for(int p = 0; p < gpl; ++p)
+  for(int q = 0; q <= p; ++q)
+  {
+    World::GVertex const & P = world.get_node(p);
+    World::GVertex const & Q = world.get_node(q);
+
+    bool visible;
+    if (P.shapeno == Q.shapeno)
+      visible = P.shapeno >= 0 && (p - q == 1 || p - q == world.gshapes[P.shapeno].vertices - 1);
+    else
+      visible = !shapesIntersect(world, P, Q);
+
+    world.isvisible(p,q) = visible;
+    if (visible)
+      world.distanceCache(p,q) = P.distanceTo(Q);
+  }
+}
+
+struct MatrixDist
+{
+  double d;
+  int i;
+  vector<int>::iterator heappos;
+  MatrixDist() : d(HUGE_VAL), i(-1) {}
+};
+
+struct MatrixCompare
+{
+  vector<MatrixDist> & d;
+  MatrixCompare(vector<MatrixDist> & d_) : d(d_) { }
+  bool operator()(int a, int b) { return d[a].d > d[b].d; }
+};
+
+struct MatrixUpdate
+{
+  vector<MatrixDist> & d;
+  MatrixUpdate(vector<MatrixDist> & d_) : d(d_) { }
+  void operator()(int i, vector<int>::iterator pos) { d[i].heappos = pos; }
+};
+
+//! findPath as it was, scanning a whole matrix row for each node
+vector<int> matrixFindPath(World & world)
+{
+  int n = world.nodes.size();
+  vector<MatrixDist> d(n);
+  d[0].d = 0;
+
+  vector<int> heap;
+  for(int i = 0; i < n; ++i)
+    heap.push_back(i);
+  make_heap(heap.begin(), heap.end(), MatrixCompare(d));
+  for(vector<int>::iterator i = heap.begin(); i != heap.end(); ++i)
+    d[*i].heappos = i;
+
+  vector<int>::iterator endheap = heap.end();
+  while(endheap > heap.begin())
+  {
+    int v = heap[0];
+    pop_mheap(heap.begin(), endheap, MatrixCompare(d), MatrixUpdate(d));
+    --endheap;
+
+    for(int w = 0; w < n; ++w)
+    if (world.isvisible(v,w))
+    {
+      double Wdistance = d[v].d + world.distanceCache(v,w);
+      if (Wdistance < d[w].d)
+      {
+        d[w].d = Wdistance;
+        d[w].i = v;
+        decreasekey_mheap(heap.begin(), d[w].heappos, MatrixCompare(d), MatrixUpdate(d));
+      }
+    }
+  }
+
+  vector<int> path;
+  for(int i = n - 1; i >= 0; i = d[i].i)
+    path.push_back(i);
+  return path;
+}
+
+//! print one row of the soa comparison
+void printTables(char const * phase, size_t nodes, double before, double after, long long missesBefore, long long missesAfter)
+{
+  cout << phase << '\t' << nodes << '\t' << before << '\t' << after << '\t' << before / after << '\t';
+  if (missesBefore < 0)
+    cout << "n/a\tn/a" << endl;
+  else
+    cout << missesBefore << '\t' << missesAfter << endl;
+}
+
+//! Planner loops over structs and matrix rows vs flat node, edge and adjacency tables
+void bench_tables()
+{
+  const int PATH_REPS = 20;
+  CacheMisses misses;
+  if (!misses.available())
+    cout << "cache miss counter not available here, only times are shown" << endl;
+
+  cout << "phase\tnodes\tstructs s\ttables s\tspeedup\tstructs misses\ttables misses" << endl;
+
+  long sizes[] = { 200, 400, 800, 1600 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    World world;
+    makeWorld(world, sizes[i]);
+    world.growShapes(1.0);
+
+    Timer t;
+    misses.start();
+    world.makeVisibility();
+    long long tableMisses = misses.stop();
+    double tables = t.elapsed();
+
+    vector<bool> reference(world.isvisible.raw(), world.isvisible.raw() + world.isvisible.elements());
+
+    t.restart();
+    misses.start();
+    aosVisibility(world);
+    long long structMisses = misses.stop();
+    double structs = t.elapsed();
+
+    if (!std::equal(reference.begin(), reference.end(), world.isvisible.raw()))
+      BARF("Visibility from the node and edge tables differs");
+
+    printTables("visibility", world.nodes.size(), structs, tables, structMisses, tableMisses);
+
+    t.restart();
+    misses.start();
+    for(int r = 0; r < PATH_REPS; ++r)
+      world.findPath();
+    tableMisses = misses.stop();
+    tables = t.elapsed() / PATH_REPS;
+
+    vector<int> path;
+    t.restart();
+    misses.start();
+    for(int r = 0; r < PATH_REPS; ++r)
+      path = matrixFindPath(world);
+    structMisses = misses.stop();
+    structs = t.elapsed() / PATH_REPS;
+
+    if (path != world.path)
+      BARF("Path from the adjacency lists differs");
+
+    printTables("findPath", world.nodes.size(), structs, tables, structMisses, tableMisses);
+  }
+}
+
+//! a point for the graham scan convexHull used to have, with its angle from the pivot
+struct AngularPoint
+{
+  World::GVertex const * point;
+  double angle;
+  AngularPoint(World::GVertex const * point_, double angle_) : point(point_), angle(angle_) { }
+};
+
+struct AngularLess
+{
+  World::GVertex const * pivot;
+  AngularLess(World::GVertex const * pivot_) : pivot(pivot_) { }
+
+  bool operator()(AngularPoint a, AngularPoint b)
+  {
+    if (a.angle != b.angle)
+      return a.angle < b.angle;
+    bool acloser = a.point->distanceTo(*pivot) < b.point->distanceTo(*pivot);
+    return (a.angle <= PI / 2.0) ? acloser : !acloser;
+  }
+};
+
+//! the atan2 graham scan that convexHull replaced, for comparison
+vector<World::GVertex>::iterator angularHull(vector<World::GVertex> const & points, vector<World::GVertex>::iterator hullStart)
+{
+  World::GVertex const * pivot = &points[0];
+  for(size_t i = 1; i < points.size(); ++i)
+    if (points[i].y < pivot->y || (points[i].y == pivot->y && points[i].x > pivot->x))
+      pivot = &points[i];
+
+  vector<AngularPoint> cpoints;
+  cpoints.push_back(AngularPoint(pivot, 0));
+  for(size_t i = 0; i < points.size(); ++i)
+    if (!points[i].equals(*pivot))
+      cpoints.push_back(AngularPoint(&points[i], atan2(points[i].y - pivot->y, points[i].x - pivot->x)));
+
+  sort(cpoints.begin() + 1, cpoints.end(), AngularLess(pivot));
+
+  vector<World::GVertex>::iterator hull = hullStart;
+  *hull++ = *cpoints[0].point;
+  *hull++ = *cpoints[1].point;
+  for(size_t i = 2; i < cpoints.size(); )
+  {
+    if (hull - hullStart == 1 || cpoints[i].point->line_rside(*(hull-2), *(hull-1)) == World::WPoint::LEFT_SIDE)
+      *hull++ = *cpoints[i++].point;
+    else
+      --hull;
+  }
+
+  if (hull - hullStart > 2 && hullStart->line_rside(*(hull-2), *(hull-1)) != World::WPoint::LEFT_SIDE)
+    --hull;
+  return hull;
+}
+
+//! Convex hull of grown obstacles: old atan2 graham scan vs monotone chain with scratch space
+void bench_hull()
+{
+  typedef World::WPoint WPoint;
+  const int POINTS = 1 << 20; // hull input points per size, in total
+
+  cout << "obstacle vertices\thull points\tgraham us\tmonotone us\tspeedup" << endl;
+
+  int sizes[] = { 3, 4, 8, 16, 64, 256, 1024 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    int n = sizes[i];
+    int count = POINTS / (PioneerFootprint::CORNERS * n);
+
+    // obstacles with n vertices on a jittered circle, expanded by the robot's corners like growShapes does
+    vector<vector<World::GVertex> > inputs(count);
+    unsigned seed = 777;
+    for(int c = 0; c < count; ++c)
+    for(int v = 0; v < n; ++v)
+    {
+      seed = seed * 1103515245 + 12345;
+      double a = 2 * PI * (v + (seed >> 8) % 1000 / 2000.0) / n;
+      WPoint p((int)(5000 * cos(a)), (int)(5000 * sin(a)));
+      for(int rv = 0; rv < PioneerFootprint::CORNERS; ++rv)
+        inputs[c].push_back(World::GVertex(p + World::robot[rv] - World::robot[PioneerFootprint::CORNERS], c, v));
+    }
+
+    vector<World::GVertex> hull(PioneerFootprint::CORNERS * n), scratch;
+    long graham = 0, monotone = 0;
+
+    Timer t;
+    for(int c = 0; c < count; ++c)
+      graham += angularHull(inputs[c], hull.begin()) - hull.begin();
+    double gtime = t.elapsed() / count * 1e6;
+
+    t.restart();
+    for(int c = 0; c < count; ++c)
+      monotone += convexHull(inputs[c].begin(), inputs[c].end(), hull.begin(), scratch) - hull.begin();
+    double mtime = t.elapsed() / count * 1e6;
+
+    // same points in the same order
+    for(int c = 0; c < count; ++c)
+    {
+      vector<World::GVertex> a(PioneerFootprint::CORNERS * n);
+      a.resize(angularHull(inputs[c], a.begin()) - a.begin());
+      hull.resize(convexHull(inputs[c].begin(), inputs[c].end(), hull.begin(), scratch) - hull.begin());
+      for(size_t v = 0; v < a.size() && a.size() == hull.size(); ++v)
+        if (!a[v].equals(hull[v]))
+          a.resize(0);
+      if (a.size() != hull.size())
+        BARF("Monotone chain hull differs from the graham scan");
+      hull.resize(PioneerFootprint::CORNERS * n);
+    }
+
+    cout << n << '\t' << PioneerFootprint::CORNERS * n << '\t' << gtime << '\t' << mtime << '\t' << gtime / mtime << endl;
+  }
+}
+
+//! true if two worlds have the same grown shapes, down to shapeno and vertexno
+bool sameGrowth(World const & a, World const & b)
+{
+  if (a.gshapes.size() != b.gshapes.size() || a.gvertices.size() != b.gvertices.size())
+    return false;
+  for(size_t i = 0; i < a.gshapes.size(); ++i)
+    if (a.gshapes[i].startidx != b.gshapes[i].startidx || a.gshapes[i].vertices != b.gshapes[i].vertices)
+      return false;
+  for(size_t i = 0; i < a.gvertices.size(); ++i)
+  {
+    World::GVertex const & p = a.gvertices[i];
+    World::GVertex const & q = b.gvertices[i];
+    if (!p.equals(q) || p.shapeno != q.shapeno || p.vertexno != q.vertexno)
+      return false;
+  }
+  return true;
+}
+
+//! Obstacle growth: hull of the point cloud vs Minkowski edge merge
+void bench_grow()
+{
+  typedef World::WPoint WPoint;
+  const int VERTICES = 1 << 16; // obstacle vertices per map
+
+  cout << "obstacle vertices\tobstacles\thull ms\tminkowski ms\tspeedup" << endl;
+
+  int sizes[] = { 4, 16, 64, 256 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    int n = sizes[i];
+    World hull, minkowski;
+
+    // regular polygons of n vertices, clockwise and counterclockwise, in a row
+    for(int c = 0; c < VERTICES / n; ++c)
+    {
+      hull.shapes.push_back(World::Shape(hull.vertices.size(), n));
+      for(int v = 0; v < n; ++v)
+      {
+        double a = 2 * PI * v / n * (c % 2 ? 1 : -1);
+        WPoint p(c * 12000 + (int)(5000 * cos(a)), (int)(5000 * sin(a)));
+        hull.vertices.push_back(World::Vertex(p, c));
+      }
+    }
+    minkowski.shapes = hull.shapes;
+    minkowski.vertices = hull.vertices;
+    hull.growEngine = World::GROW_HULL;
+    minkowski.growEngine = World::GROW_MINKOWSKI;
+
+    Timer t;
+    hull.growShapes(1.0);
+    double htime = t.elapsed() * 1e3;
+
+    t.restart();
+    minkowski.growShapes(1.0);
+    double mtime = t.elapsed() * 1e3;
+
+    if (!sameGrowth(hull, minkowski))
+      BARF("Minkowski growth differs from the hull engine");
+
+    cout << n << '\t' << hull.shapes.size() << '\t' << htime << '\t' << mtime << '\t' << htime / mtime << endl;
+  }
+}
+
+/*! Fixed point coordinate in 1/256 mm, stored in 64 bits
+
+   Has just the operators Point and convexHull need. Orientation tests
+   widen it to double like float, which is exact at this resolution.
+*/
+class Fixed
+{
+public:
+  enum { BITS = 8, ONE = 1 << BITS };
+
+  Fixed(int i = 0) : raw((long long)i << BITS) { }
+  explicit Fixed(double d) : raw((long long)floor(d * ONE + 0.5)) { }
+
+  operator double() const
+  {
+    return raw / (double)ONE;
+  }
+
+  Fixed operator+(Fixed b) const { return fromRaw(raw + b.raw); }
+  Fixed operator-(Fixed b) const { return fromRaw(raw - b.raw); }
+  Fixed operator-() const { return fromRaw(-raw); }
+  Fixed operator*(Fixed b) const { return fromRaw(raw * b.raw >> BITS); }
+  Fixed operator/(Fixed b) const { return fromRaw((raw << BITS) / b.raw); }
+
+  bool operator==(Fixed b) const { return raw == b.raw; }
+  bool operator!=(Fixed b) const { return raw != b.raw; }
+  bool operator<(Fixed b) const { return raw < b.raw; }
+  bool operator>(Fixed b) const { return raw > b.raw; }
+  bool operator<=(Fixed b) const { return raw <= b.raw; }
+  bool operator>=(Fixed b) const { return raw >= b.raw; }
+
+private:
+  long long raw;
+
+  static Fixed fromRaw(long long r)
+  {
+    Fixed f;
+    f.raw = r;
+    return f;
+  }
+};
+
+template<> struct _Point_wide<Fixed> { typedef double type; };
+
+/*! The planning pipeline on Point<T>
+
+   World is written for int coordinates, so this is a plain copy of its
+   pipeline for the coordinate comparison: grow with the point cloud hull,
+   visibility against every grown edge, then Dijkstra on the matrix. The
+   rules are the same as World's, so the graphs and paths match, but it
+   leaves out what World does to be fast: the Minkowski grow engine, the
+   workers, the grow cache, the EdgeTable, sweep and grid visibility
+   engines, bitangentsOnly, and findPath's heap. mergeOverlaps isn't
+   copied either, it is off in bench coords. The times compare the types
+   against each other; runWorld times the shipped pipeline on int for
+   scale.
+*/
+template<typename T>
+struct Pipeline
+{
+  typedef Point<T> P;
+
+  vector<P> obstacle;
+  vector<World::Shape> shapes;
+  vector<P> grown;
+  vector<World::Shape> gshapes;
+  vector<int> grownShape;
+
+  vector<P> nodes; // start, grown vertices outside other shapes, goal
+  vector<int> nodeShape;
+  vector<int> nodeVertex;
+  SMatrix<bool> isvisible;
+  SMatrix<double> distance;
+  double pathLength;
+  P start, goal;
+
+  void load(World const & world, double mult)
+  {
+    for(size_t v = 0; v < world.vertices.size(); ++v)
+      obstacle.push_back(P(world.vertices[v]));
+    shapes = world.shapes;
+    start = center(world.startarea);
+    goal = center(world.goalarea);
+
+    for(int rv = 0; rv < PioneerFootprint::CORNERS; ++rv)
+      corners.push_back(scaled(World::robot[rv], mult) - scaled(World::robot[PioneerFootprint::CORNERS], mult));
+  }
+
+  void grow()
+  {
+    vector<P> points, hull, scratch;
+    for(size_t s = 0; s < shapes.size(); ++s)
+    {
+      points.resize(0);
+      for(int v = shapes[s].startidx; v < shapes[s].startidx + shapes[s].vertices; ++v)
+        for(size_t rv = 0; rv < corners.size(); ++rv)
+          points.push_back(obstacle[v] + corners[rv]);
+
+      hull.resize(points.size());
+      hull.resize(convexHull(points.begin(), points.end(), hull.begin(), scratch) - hull.begin());
+      gshapes.push_back(World::Shape(grown.size(), hull.size()));
+      grown.insert(grown.end(), hull.begin(), hull.end());
+      grownShape.insert(grownShape.end(), hull.size(), (int)s);
+    }
+  }
+
+  void visibility()
+  {
+    addNode(start, -1, -1);
+    for(size_t v = 0; v < grown.size(); ++v)
+      if (!inside(grown[v]))
+        addNode(grown[v], grownShape[v], v);
+    addNode(goal, -1, -1);
+
+    int n = nodes.size();
+    isvisible.resize(n);
+    distance.resize(n);
+    for(int p = 0; p < n; ++p)
+    for(int q = 0; q <= p; ++q)
+    {
+      bool visible;
+      if (nodeShape[p] == nodeShape[q])
+        visible = nodeShape[p] >= 0 && (p - q == 1 || p - q == gshapes[nodeShape[p]].vertices - 1);
+      else
+        visible = !blocked(nodes[p], nodes[q]);
+      isvisible(p,q) = visible;
+      if (visible)
+        distance(p,q) = nodes[p].distanceTo(nodes[q]);
+    }
+  }
+
+  void findPath()
+  {
+    int n = nodes.size();
+    vector<double> d(n, HUGE_VAL);
+    vector<bool> done(n, false);
+    d[0] = 0;
+    for(;;)
+    {
+      int v = -1;
+      for(int i = 0; i < n; ++i)
+        if (!done[i] && (v < 0 || d[i] < d[v]))
+          v = i;
+      if (v < 0 || d[v] == HUGE_VAL) break;
+      done[v] = true;
+      for(int w = 0; w < n; ++w)
+        if (isvisible(v,w) && d[v] + distance(v,w) < d[w])
+          d[w] = d[v] + distance(v,w);
+    }
+    pathLength = d[n - 1];
+  }
+
+  //! bytes held by the coordinates and the visibility matrices
+  size_t bytes(size_t & coordinates)
+  {
+    coordinates = (obstacle.size() + grown.size() + nodes.size() + corners.size()) * sizeof(P);
+    return coordinates + isvisible.elements() * (sizeof(bool) + sizeof(double));
+  }
+
+private:
+  vector<P> corners; // robot corners relative to its reference point
+
+  static P scaled(World::WPoint p, double mult)
+  {
+    return P(static_cast<T>(p.x * mult), static_cast<T>(p.y * mult));
+  }
+
+  static P center(vector<World::WPoint> const & area)
+  {
+    P sum;
+    for(size_t i = 0; i < area.size(); ++i)
+      sum = sum + P(area[i]);
+    return sum / static_cast<T>((int)area.size());
+  }
+
+  void addNode(P p, int shape, int vertex)
+  {
+    nodes.push_back(p);
+    nodeShape.push_back(shape);
+    nodeVertex.push_back(vertex);
+  }
+
+  bool inside(P p)
+  {
+    for(size_t s = 0; s < gshapes.size(); ++s)
+    {
+      int sv = gshapes[s].startidx, nv = gshapes[s].vertices;
+      bool in = true;
+      for(int e = 0; e < nv && in; ++e)
+        in = p.line_rside(grown[sv + e], grown[sv + (e + 1) % nv]) == P::LEFT_SIDE;
+      if (in) return true;
+    }
+    return false;
+  }
+
+  bool blocked(P p, P q)
+  {
+    for(size_t s = 0; s < gshapes.size(); ++s)
+    {
+      int sv = gshapes[s].startidx, nv = gshapes[s].vertices;
+      for(int e = 0; e < nv; ++e)
+        if (linesIntersect(p, q, grown[sv + e], grown[sv + (e + 1) % nv]))
+          return true;
+    }
+    return false;
+  }
+};
+
+//! results of one coordinate type on one map
+struct TypeResult
+{
+  double grow, visibility, path;
+  size_t bytes, coordinates;
+  long edges;
+  double length;
+};
+
+template<typename T>
+TypeResult runPipeline(World const & world, double mult)
+{
+  TypeResult r;
+  Pipeline<T> pipeline;
+  pipeline.load(world, mult);
+
+  Timer t;
+  pipeline.grow();
+  r.grow = t.elapsed();
+
+  t.restart();
+  pipeline.visibility();
+  r.visibility = t.elapsed();
+
+  t.restart();
+  pipeline.findPath();
+  r.path = t.elapsed();
+
+  r.bytes = pipeline.bytes(r.coordinates);
+  r.edges = std::count(pipeline.isvisible.raw(), pipeline.isvisible.raw() + pipeline.isvisible.elements(), true);
+  r.length = pipeline.pathLength;
+  return r;
+}
+
+//! the same stages with World itself, which only has int coordinates
+TypeResult runWorld(World const & source, double mult)
+{
+  TypeResult r;
+  World world;
+  world.shapes = source.shapes;
+  world.vertices = source.vertices;
+  world.startarea = source.startarea;
+  world.goalarea = source.goalarea;
+
+  Timer t;
+  world.growShapes(mult);
+  r.grow = t.elapsed();
+
+  t.restart();
+  world.makeVisibility();
+  r.visibility = t.elapsed();
+
+  t.restart();
+  world.findPath();
+  r.path = t.elapsed();
+
+  r.coordinates = world.vertices.size() * sizeof(World::Vertex) + world.gvertices.size() * sizeof(World::GVertex);
+  r.bytes = r.coordinates + world.isvisible.elements() * (sizeof(bool) + sizeof(double));
+  r.edges = std::count(world.isvisible.raw(), world.isvisible.raw() + world.isvisible.elements(), true);
+  r.length = HUGE_VAL;
+  if (!world.path.empty() && world.path.back() == 0)
+  {
+    r.length = 0;
+    for(size_t p = 1; p < world.path.size(); ++p)
+      r.length += world.get_node(world.path[p]).distanceTo(world.get_node(world.path[p - 1]));
+  }
+  return r;
+}
+
+//! nanoseconds per call of the geometry primitives on Point<T>
+template<typename T>
+void timePrimitives(char const * name, vector<World::WPoint> const & ipoints)
+{
+  const int REPS = 20;
+  vector<Point<T> > points(ipoints.begin(), ipoints.end());
+  size_t n = points.size(), mask = n - 1;
+
+  long sum = 0;
+  Timer t;
+  for(int r = 0; r < REPS; ++r)
+  for(size_t i = 0; i < n; ++i)
+    sum += points[i].line_rside(points[(i + 1) & mask], points[(i + 2) & mask]);
+  double side = t.elapsed() / REPS / n * 1e9;
+
+  t.restart();
+  for(int r = 0; r < REPS; ++r)
+  for(size_t i = 0; i < n; ++i)
+    sum += linesIntersect(points[i], points[(i + 1) & mask], points[(i + 2) & mask], points[(i + 3) & mask]);
+  double intersect = t.elapsed() / REPS / n * 1e9;
+
+  double length = 0;
+  t.restart();
+  for(int r = 0; r < REPS; ++r)
+  for(size_t i = 0; i < n; ++i)
+    length += points[i].distanceTo(points[(i + 1) & mask]);
+  double distance = t.elapsed() / REPS / n * 1e9;
+
+  cout << name << '\t' << sizeof(Point<T>) << '\t' << side << '\t' << intersect << '\t' << distance
+       << "\t(checksum " << sum << ' ' << (long)length << ")" << endl;
+}
+
+//! Coordinate types: geometry primitives and the whole pipeline with each
+void bench_coords()
+{
+  typedef World::WPoint WPoint;
+  const double MULT = 1.37; // gives the robot fractional corners
+
+  vector<WPoint> points(1 << 16);
+  unsigned seed = 2468;
+  for(size_t i = 0; i < points.size(); ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    int x = (seed >> 8) % 20000;
+    seed = seed * 1103515245 + 12345;
+    points[i] = WPoint(x, (seed >> 8) % 20000);
+  }
+
+  cout << "type\tpoint bytes\tline_rside ns\tlinesIntersect ns\tdistanceTo ns" << endl;
+  timePrimitives<int>("int32", points);
+  timePrimitives<long long>("int64", points);
+  timePrimitives<float>("float", points);
+  timePrimitives<double>("double", points);
+  timePrimitives<Fixed>("fixed", points);
+  cout << endl;
+
+  // World first, the shipped pipeline the copies are measured against
+  char const * names[] = { "World", "int32", "int64", "float", "double", "fixed" };
+  TypeResult (*runs[])(World const &, double) =
+  {
+    runWorld, runPipeline<int>, runPipeline<long long>, runPipeline<float>, runPipeline<double>, runPipeline<Fixed>
+  };
+
+  cout << "vertices\ttype\tgrow ms\tvisibility ms\tpath ms\tcoordinate bytes\ttotal bytes\tedges\tpath mm\tvs World mm" << endl;
+  long sizes[] = { 100, 200, 400 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    World world;
+    makeWorld(world, sizes[i]);
+
+    double reference = 0;
+    for(int t = 0; t < DIM(runs); ++t)
+    {
+      TypeResult r = runs[t](world, MULT);
+      if (t == 0) reference = r.length;
+      cout << sizes[i] << '\t' << names[t] << '\t' << r.grow * 1e3 << '\t' << r.visibility * 1e3 << '\t'
+           << r.path * 1e3 << '\t' << r.coordinates << '\t' << r.bytes << '\t' << r.edges << '\t'
+           << r.length << '\t' << r.length - reference << endl;
+    }
+  }
+}
+
+/*! Fill world with n pentagons scattered at random, many of them overlapping once grown
+
+   The map grows with n so the number of neighbours per obstacle stays about
+   the same.
+*/
+void makeClutter(World & world, int n, int sides = 5)
+{
+  typedef World::WPoint WPoint;
+
+  world.vertices.resize(0);
+  world.shapes.resize(0);
+  int side = (int)(sqrt((double)n) * 3000);
+  unsigned seed = 1357;
+  for(int s = 0; s < n; ++s)
+  {
+    seed = seed * 1103515245 + 12345;
+    int x = (seed >> 8) % side;
+    seed = seed * 1103515245 + 12345;
+    int y = (seed >> 8) % side;
+    int r = 200 + (seed >> 4) % 600;
+
+    world.shapes.push_back(World::Shape(world.vertices.size(), sides));
+    for(int v = 0; v < sides; ++v)
+      world.vertices.push_back(World::Vertex(WPoint(x + (int)(r * cos(2 * PI * v / sides)), y + (int)(r * sin(2 * PI * v / sides))), s));
+  }
+}
+
+//! the overlap search of noIntersect as it was, testing the edges of every pair of shapes. returns the merges
+int bruteOverlaps(vector<World::Shape> const & shapes, vector<World::GVertex> vertices)
+{
+  int merges = 0;
+  for(size_t shape1 = 0; shape1 < shapes.size(); ++shape1)
+  {
+    int sv1 = shapes[shape1].startidx, nv1 = shapes[shape1].vertices;
+    for(size_t shape2 = 0; shape2 < shape1; ++shape2)
+    {
+      int sv2 = shapes[shape2].startidx, nv2 = shapes[shape2].vertices;
+      if (vertices[sv2].shapeno == vertices[sv1].shapeno)
+        continue;
+
+      for(int e1 = 0; e1 < nv1; ++e1)
+      for(int e2 = 0; e2 < nv2; ++e2)
+        if (linesIntersect<World::coord>(vertices[sv1 + e1], vertices[sv1 + (e1 + 1) % nv1],
+                                         vertices[sv2 + e2], vertices[sv2 + (e2 + 1) % nv2]))
+        {
+          int later = vertices[sv1].shapeno, earlier = vertices[sv2].shapeno;
+          for(int v = 0; v < sv1; ++v)
+            if (vertices[v].shapeno == earlier)
+              vertices[v].shapeno = later;
+          ++merges;
+          e1 = nv1;
+          break;
+        }
+    }
+  }
+  return merges;
+}
+
+//! Overlapping grown shapes: every pair vs the sweep and prune broad phase, and the whole merge loop
+void bench_merge()
+{
+  const int BRUTE = 2000; // all pairs takes too long above this
+
+  cout << "obstacles\tall pairs ms\tone pass ms\tspeedup\tmerge loop ms\tmerged shapes" << endl;
+
+  int sizes[] = { 500, 1000, 2000, 8000, 32000 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    int n = sizes[i];
+    World world;
+    makeClutter(world, n);
+    world.growShapes(1.0);
+
+    double btime = 0;
+    if (n <= BRUTE)
+    {
+      Timer t;
+      bruteOverlaps(world.gshapes, world.gvertices);
+      btime = t.elapsed() * 1e3;
+    }
+
+    vector<World::Shape> sbefore(world.gshapes), safter;
+    vector<World::GVertex> vbefore(world.gvertices), vafter;
+    Timer t;
+    world.noIntersect(sbefore, vbefore, safter, vafter);
+    double ptime = t.elapsed() * 1e3;
+
+    world.mergeOverlaps = true;
+    t.restart();
+    world.growShapes(1.0);
+    double mtime = t.elapsed() * 1e3;
+
+    cout << n << '\t';
+    if (n <= BRUTE)
+      cout << btime << '\t' << ptime << '\t' << btime / ptime;
+    else
+      cout << "-\t" << ptime << "\t-";
+    cout << '\t' << mtime << '\t' << world.gshapes.size() << endl;
+  }
+}
+
+//! length of the path findPath found, 0 if there isn't one
+double pathLength(World & world)
+{
+  double length = 0;
+  for(size_t i = 1; i < world.path.size(); ++i)
+    length += world.get_node(world.path[i]).distanceTo(world.get_node(world.path[i - 1]));
+  return length;
+}
+
+//! Rotation aware slices against growing for one heading with the usual multiplier
+//! (X - R) x (S - R) puts X more than a hair to the left of every edge RS of the shape
+bool strictlyInside(World & world, World::Shape const & shape, double x, double y)
+{
+  for(int i = 0; i < shape.vertices; ++i)
+  {
+    World::WPoint R = world.gvertices[shape.startidx + i];
+    World::WPoint S = world.gvertices[shape.startidx + (i + 1) % shape.vertices];
+    double ex = (double)S.x - R.x, ey = (double)S.y - R.y;
+    if (ex * (y - R.y) - ey * (x - R.x) <= 1e-6 * sqrt(ex * ex + ey * ey))
+      return false;
+  }
+  return true;
+}
+
+//! slice of node p of a sliced world, -1 for the start and goal
+int nodeSlice(World & world, int p)
+{
+  int v = world.nodes[p];
+  if (v < 0)
+    return -1;
+  int s = world.slices.size() - 1;
+  while (world.slices[s].firstshape > world.gvertices[v].shapeno)
+    --s;
+  return s;
+}
+
+//! BARFs if a visible edge of a sliced world goes inside an obstacle of either slice of its sector,
+//! or if neither of its ends is the start, the goal or a corner of those slices
+void checkSlices(World & world)
+{
+  int k = world.slices.size();
+  int n = world.nodes.size();
+  for(int p = 0; p < n; ++p)
+  for(int q = 0; q < p; ++q)
+  {
+    if (!world.isvisible(p,q))
+      continue;
+
+    // the sector the same way _World_slices works it out
+    World::GVertex P = world.get_node(p), Q = world.get_node(q);
+    double turn = fmod(atan2((double)Q.y - P.y, (double)Q.x - P.x) - PI / 2, PI);
+    if (turn < 0) turn += PI;
+    int s = std::min((int)(turn * k / PI), k - 1);
+
+    int a = nodeSlice(world, p), b = nodeSlice(world, q);
+    if (a >= 0 && a != s && a != (s + 1) % k && b >= 0 && b != s && b != (s + 1) % k)
+      BARF("visible edge has no end in a slice of its sector");
+
+    for(int slice = s; slice <= s + 1; ++slice)
+    {
+      int first = world.slices[slice % k].firstshape;
+      int end = slice % k + 1 < k ? world.slices[slice % k + 1].firstshape : world.gshapes.size();
+      for(int i = first; i < end; ++i)
+      for(int j = 1; j < 4; ++j)
+        if (strictlyInside(world, world.gshapes[i], P.x + (Q.x - P.x) * j / 4.0, P.y + (Q.y - P.y) * j / 4.0))
+          BARF("visible edge goes through an obstacle of its sector");
+    }
+  }
+}
+
+void bench_slices()
+{
+  WorkerPool pool;
+
+  cout << "vertices\theadings\tmultiplier\tnodes\tgrow ms\tvisibility ms\tpath ms\tplanning vs single\tpath mm" << endl;
+
+  long sizes[] = { 100, 400 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    double single = 0;
+    int headings[] = { 0, 1, 4, 8, 16 };
+    for(int h = 0; h < DIM(headings); ++h)
+    {
+      int k = headings[h];
+      double mult = k ? 1.0 : 1.6; // one heading needs the margin for turning
+      World world;
+      makeWorld(world, sizes[i]);
+      world.workers = &pool;
+
+      Timer t;
+      if (k)
+        world.growSlices(k, mult);
+      else
+        world.growShapes(mult);
+      double grow = t.elapsed();
+
+      t.restart();
+      world.makeVisibility();
+      double visibility = t.elapsed();
+
+      t.restart();
+      world.findPath();
+      double path = t.elapsed();
+
+      if (k)
+        checkSlices(world);
+
+      double total = grow + visibility + path;
+      if (k == 0) single = total;
+
+      cout << sizes[i] << '\t' << k << '\t' << mult << '\t' << world.nodes.size() << '\t' << grow * 1e3 << '\t'
+           << visibility * 1e3 << '\t' << path * 1e3 << '\t' << total / single << '\t' << pathLength(world) << endl;
+    }
+  }
+}
+
+//! Per-shape obstacle growth on 1 to N threads, against the serial result
+void bench_growthreads()
+{
+  cout << "obstacles\tmethod\tthreads\tms\tspeedup" << endl;
+
+  int sizes[] = { 10000, 40000 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    char const * names[] = { "hull", "minkowski", "fgrowShapes" };
+    for(int m = 0; m < DIM(names); ++m)
+    {
+      World serial;
+      makeClutter(serial, sizes[i]);
+      serial.growEngine = m == 0 ? World::GROW_HULL : World::GROW_MINKOWSKI;
+
+      Timer t;
+      if (m == 2)
+        serial.fgrowShapes(400);
+      else
+        serial.growShapes(1.0);
+      double single = t.elapsed();
+      cout << sizes[i] << '\t' << names[m] << "\tserial\t" << single * 1e3 << "\t1" << endl;
+
+      vector<int> counts = threadCounts();
+      for(size_t c = 0; c < counts.size(); ++c)
+      {
+        WorkerPool pool(counts[c]);
+        World world;
+        makeClutter(world, sizes[i]);
+        world.growEngine = serial.growEngine;
+        world.workers = &pool;
+
+        t.restart();
+        if (m == 2)
+          world.fgrowShapes(400);
+        else
+          world.growShapes(1.0);
+        double seconds = t.elapsed();
+
+        if (!sameGrowth(serial, world))
+          BARF("parallel growth differs from the serial growth");
+
+        cout << sizes[i] << '\t' << names[m] << '\t' << counts[c] << '\t' << seconds * 1e3 << '\t' << single / seconds << endl;
+      }
+    }
+  }
+}
+
+//! grow the way bench_growcache's method m does
+void growCacheMethod(World & world, int m)
+{
+  if (m == 0)
+    world.growShapes(1.0);
+  else if (m == 1)
+    world.fgrowShapes(400);
+  else if (m == 2 || m == 4)
+    world.growSlices(8, 1.0);
+  else
+  {
+    world.growEngine = World::GROW_HULL;
+    world.growShapes(1.0);
+  }
+}
+
+//! Regrowing a map with 5% of its obstacles moved, with and without the grow cache
+void bench_growcache()
+{
+  char const * CACHE = "bench_grow.cache";
+
+  cout << "obstacles\tsides\tmethod\tuncached ms\tfirst run ms\tload ms\tcached ms\thits\tmisses\tspeedup" << endl;
+
+  struct { int obstacles, sides, method; } cases[] =
+  {
+    { 10000, 5, 0 }, { 10000, 5, 1 }, { 40000, 5, 0 }, { 40000, 5, 1 },
+    { 10000, 40, 0 }, { 10000, 40, 1 }, { 10000, 5, 2 }, { 10000, 5, 4 }, { 10000, 5, 3 }, { 10000, 40, 3 }
+  };
+  char const * names[] = { "growShapes", "fgrowShapes", "growSlices 8", "GROW_HULL", "growSlices 8 on 4 threads" };
+  WorkerPool pool(4);
+  for(int i = 0; i < DIM(cases); ++i)
+  {
+    int m = cases[i].method;
+    remove(CACHE);
+    World world;
+    makeClutter(world, cases[i].obstacles, cases[i].sides);
+    if (m == 4)
+      world.workers = &pool;
+
+    // fill the cache from the first run
+    GrowCache cache;
+    world.growCache = &cache;
+    Timer t;
+    growCacheMethod(world, m);
+    double first = t.elapsed();
+    cache.save(CACHE);
+
+    // move every twentieth obstacle
+    for(size_t s = 0; s < world.shapes.size(); s += 20)
+      for(int v = world.shapes[s].startidx; v < world.shapes[s].startidx + world.shapes[s].vertices; ++v)
+        world.vertices[v].x += 100;
+
+    // regrow without the cache into the arrays left from the first run, like the cached run below
+    world.growCache = NULL;
+    t.restart();
+    growCacheMethod(world, m);
+    double plain = t.elapsed();
+
+    World uncached;
+    uncached.gshapes = world.gshapes;
+    uncached.gvertices = world.gvertices;
+
+    GrowCache loaded;
+    t.restart();
+    loaded.load(CACHE);
+    double load = t.elapsed();
+
+    world.growCache = &loaded;
+    t.restart();
+    growCacheMethod(world, m);
+    double cached = t.elapsed();
+
+    if (!sameGrowth(uncached, world))
+      BARF("grow cache gave different shapes");
+    if (loaded.hits + loaded.misses != (long)world.shapes.size() * (m == 2 || m == 4 ? 8 : 1))
+      BARF("grow cache lookups went missing");
+
+    cout << cases[i].obstacles << '\t' << cases[i].sides << '\t' << names[m] << '\t' << plain * 1e3 << '\t' << first * 1e3 << '\t'
+         << load * 1e3 << '\t' << cached * 1e3 << '\t' << loaded.hits << '\t' << loaded.misses << '\t' << plain / (load + cached) << endl;
+  }
+  remove(CACHE);
+}
+
+//! Planning for many grow multipliers, one after another and at once on the workers
+void bench_sweep()
+{
+  const int MARGINS = 16;
+
+  int sizes[] = { 100, 400 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    World world;
+    makeWorld(world, sizes[i]);
+
+    vector<World::MarginResult> serial;
+    Timer t;
+    world.sweepMargins(1.0, 2.5, MARGINS, false, serial);
+    double single = t.elapsed();
+
+    cout << "# " << sizes[i] << " vertices, serial" << endl;
+    World::outputMargins(stdout, serial);
+
+    cout << "vertices\tthreads\tsweep ms\tspeedup" << endl;
+    cout << sizes[i] << "\tserial\t" << single * 1e3 << "\t1" << endl;
+
+    vector<int> counts = threadCounts();
+    for(size_t c = 0; c < counts.size(); ++c)
+    {
+      WorkerPool pool(counts[c]);
+      world.workers = &pool;
+      vector<World::MarginResult> results;
+      t.restart();
+      world.sweepMargins(1.0, 2.5, MARGINS, false, results);
+      double seconds = t.elapsed();
+      world.workers = NULL;
+
+      for(int m = 0; m < MARGINS; ++m)
+        if (results[m].found != serial[m].found || results[m].length != serial[m].length || results[m].edges != serial[m].edges)
+          BARF("parallel sweep differs from the serial sweep");
+
+      cout << sizes[i] << '\t' << counts[c] << '\t' << seconds * 1e3 << '\t' << single / seconds << endl;
+    }
+  }
+}
+
+//! squares on a grid, grown until neighbours share their sides, so that many edges are collinear
+//! and cross at the same points
+void makeGrid(World & world, int n)
+{
+  typedef World::WPoint WPoint;
+
+  world.vertices.resize(0);
+  world.shapes.resize(0);
+  int columns = (int)sqrt((double)n / 4) + 1;
+  for(int s = 0; s < n / 4; ++s)
+  {
+    int x = (s % columns) * 600, y = (s / columns) * 600;
+    WPoint square[] = { WPoint(x, y), WPoint(x + 400, y), WPoint(x + 400, y + 400), WPoint(x, y + 400) };
+    world.shapes.push_back(World::Shape(world.vertices.size(), DIM(square)));
+    for(int v = 0; v < DIM(square); ++v)
+      world.vertices.push_back(World::Vertex(square[v], s));
+  }
+  WPoint start[] = { WPoint(-300, -300) }, goal[] = { WPoint(columns * 600, columns * 600) };
+  world.startarea.assign(start, start + DIM(start));
+  world.goalarea.assign(goal, goal + DIM(goal));
+  world.start = world.goal = World::GVertex();
+  world.fgrowShapes(100);
+}
+
+//! start below left and goal above right of the obstacles, for makeClutter maps
+void addEnds(World & world)
+{
+  typedef World::WPoint WPoint;
+
+  World::coord right = 0, top = 0;
+  for(size_t v = 0; v < world.vertices.size(); ++v)
+  {
+    right = std::max(right, world.vertices[v].x);
+    top = std::max(top, world.vertices[v].y);
+  }
+  world.startarea.assign(1, WPoint(-1500, -1500));
+  world.goalarea.assign(1, WPoint(right + 1500, top + 1500));
+}
+
+//! makeVisibility with both engines on the world's grown obstacles. BARFs if the graphs differ.
+//! returns the seconds each took
+void compareVisibility(World & world, double & pairs, double & sweep)
+{
+  World swept;
+  swept.gshapes = world.gshapes;
+  swept.gvertices = world.gvertices;
+  swept.startarea = world.startarea;
+  swept.goalarea = world.goalarea;
+  swept.visibilityEngine = World::VISIBILITY_SWEEP;
+
+  world.start = world.goal = World::GVertex();
+  world.visibilityEngine = World::VISIBILITY_PAIRS;
+  Timer t;
+  world.makeVisibility();
+  pairs = t.elapsed();
+
+  t.restart();
+  swept.makeVisibility();
+  sweep = t.elapsed();
+
+  if (swept.nodes != world.nodes)
+    BARF("sweep engine picked different nodes");
+  int n = world.nodes.size();
+  for(int p = 0; p < n; ++p)
+  for(int q = 0; q <= p; ++q)
+    if (swept.isvisible(p,q) != world.isvisible(p,q) || (world.isvisible(p,q) && swept.distanceCache(p,q) != world.distanceCache(p,q)))
+      BARF("sweep engine gives a different visibility graph");
+}
+
+//! nodes as makeVisibility picks them, without the visibility matrices, which don't fit for big maps
+void makeNodes(World & world, EdgeTable & edges, NodeTable & table)
+{
+  world.start = world.goal = World::GVertex();
+  for(size_t i = 0; i < world.startarea.size(); ++i)
+    world.start = world.start + world.startarea[i];
+  world.start = world.start / world.startarea.size();
+  for(size_t i = 0; i < world.goalarea.size(); ++i)
+    world.goal = world.goal + world.goalarea[i];
+  world.goal = world.goal / world.goalarea.size();
+
+  edges.assign(world.gvertices, world.gshapes);
+  world.nodes.resize(0);
+  world.nodes.push_back(World::START);
+  for(size_t v = 0; v < world.gvertices.size(); ++v)
+    if (!edges.inside(world.gvertices[v]))
+      world.nodes.push_back(v);
+  world.nodes.push_back(World::GOAL);
+  table.assign(world);
+}
+
+//! Rotational sweep against testing every pair, on overlapping and degenerate maps
+void bench_visweep()
+{
+  // equivalence on small maps, random overlapping pentagons grown with both engines, the usual
+  // squares, and a grid where grown squares share sides
+  int checked = 0;
+  for(int n = 20; n <= 320; n *= 2)
+  for(int m = 0; m < 4; ++m)
+  {
+    World world;
+    if (m == 3)
+      makeGrid(world, n);
+    else
+    {
+      if (m == 2)
+        makeWorld(world, n);
+      else
+      {
+        makeClutter(world, n / 5);
+        addEnds(world);
+      }
+      world.growEngine = m == 1 ? World::GROW_HULL : World::GROW_MINKOWSKI;
+      world.growShapes(m == 1 ? 2.0 : 1.0);
+    }
+    double pairs, sweep;
+    compareVisibility(world, pairs, sweep);
+    ++checked;
+  }
+  cout << "# " << checked << " maps give the same graph with both engines" << endl;
+
+  cout << "vertices\tnodes\tpairs ms\tsweep ms\tspeedup" << endl;
+  int sizes[] = { 500, 1000, 2000, 4000 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    World world;
+    makeClutter(world, sizes[i] / 5);
+    addEnds(world);
+    world.growShapes(1.0);
+    double pairs, sweep;
+    compareVisibility(world, pairs, sweep);
+    cout << world.gvertices.size() << '\t' << world.nodes.size() << '\t' << pairs * 1e3 << '\t' << sweep * 1e3 << '\t' << pairs / sweep << endl;
+  }
+
+  // bigger maps don't fit in the visibility matrices. time sample rows and scale up to all of them
+  const int ROWS = 8, PAIRS = 2000;
+  cout << "vertices\tnodes\tpair us\tsweep row ms\tpairs s (est)\tsweep s (est)\tfallbacks" << endl;
+  int bigs[] = { 1000, 10000, 100000 };
+  for(int i = 0; i < DIM(bigs); ++i)
+  {
+    World world;
+    makeClutter(world, bigs[i] / 5);
+    addEnds(world);
+    world.growShapes(1.0);
+    EdgeTable edges;
+    NodeTable table;
+    makeNodes(world, edges, table);
+    long n = table.size();
+
+    RotationalSweep rows;
+    if (!rows.assign(world, table, edges))
+      BARF("map too large for the sweep");
+
+    vector<char> row;
+    Timer t;
+    for(int r = 0; r < ROWS; ++r)
+    {
+      rows.from(n - 1 - r * (n / ROWS), row);
+    }
+    double sweep = t.elapsed() / ROWS;
+
+    unsigned seed = 2468;
+    t.restart();
+    for(int k = 0; k < PAIRS; ++k)
+    {
+      seed = seed * 1103515245 + 12345;
+      int p = (seed >> 8) % n;
+      seed = seed * 1103515245 + 12345;
+      int q = (seed >> 8) % n;
+      edges.intersects(table[p], table[q]);
+    }
+    double pair = t.elapsed() / PAIRS;
+
+    cout << world.gvertices.size() << '\t' << n << '\t' << pair * 1e6 << '\t' << sweep * 1e3 << '\t'
+         << pair * n * (n - 1) / 2 << '\t' << sweep * n << '\t' << rows.fallbacks << endl;
+  }
+}
+
+//! squares, overlapping pentagons, the same merged, and the grid, grown
+void makeBitangentMap(World & world, int kind, int n)
+{
+  if (kind == 3)
+  {
+    makeGrid(world, n);
+    return;
+  }
+  if (kind == 0)
+    makeWorld(world, n);
+  else
+  {
+    makeClutter(world, n / 5);
+    addEnds(world);
+  }
+  world.mergeOverlaps = kind == 2;
+  world.growShapes(1.0);
+}
+
+long countEdges(World & world)
+{
+  long edges = 0;
+  for(int p = 0; p < (int)world.nodes.size(); ++p)
+    for(int q = 0; q < p; ++q)
+      edges += world.isvisible(p, q);
+  return edges;
+}
+
+//! Full visibility graph against only the edges tangent at both ends
+void bench_bitangent()
+{
+  const int SEARCHES = 20;
+  char const * names[] = { "squares", "clutter", "merged", "grid" };
+
+  cout << "map\tvertices\tnodes\tedges\tbitangent\tvisibility ms\treduced ms\tfindPath ms\treduced ms\tsame path" << endl;
+  int sizes[] = { 400, 1600 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  for(int kind = 0; kind < DIM(names); ++kind)
+  {
+    World full, reduced;
+    makeBitangentMap(full, kind, sizes[i]);
+    makeBitangentMap(reduced, kind, sizes[i]);
+    reduced.bitangentsOnly = true;
+
+    double visibility[2], search[2];
+    World * worlds[] = { &full, &reduced };
+    for(int w = 0; w < 2; ++w)
+    {
+      Timer t;
+      worlds[w]->makeVisibility();
+      visibility[w] = t.elapsed();
+
+      t.restart();
+      for(int k = 0; k < SEARCHES; ++k)
+        worlds[w]->findPath();
+      search[w] = t.elapsed() / SEARCHES;
+    }
+
+    // ties between paths of the same length may be broken differently
+    bool same = full.path == reduced.path;
+    bool found = full.path.back() == 0, rfound = reduced.path.back() == 0;
+    if (found != rfound || fabs(pathLength(full) - pathLength(reduced)) > 1e-6 * pathLength(full))
+      BARF("reduced visibility graph changed the shortest path");
+
+    cout << names[kind] << '\t' << full.gvertices.size() << '\t' << full.nodes.size() << '\t' << countEdges(full) << '\t'
+         << countEdges(reduced) << '\t' << visibility[0] * 1e3 << '\t' << visibility[1] * 1e3 << '\t'
+         << search[0] * 1e3 << '\t' << search[1] * 1e3 << '\t' << (same ? "yes" : "length") << endl;
+  }
+}
+
+//! same nodes, and the same edges with the same lengths
+bool sameGraph(World & a, World & b)
+{
+  if (a.nodes != b.nodes)
+    return false;
+  int n = a.nodes.size();
+  for(int p = 0; p < n; ++p)
+  for(int q = 0; q <= p; ++q)
+    if (a.isvisible(p,q) != b.isvisible(p,q) || (a.isvisible(p,q) && a.distanceCache(p,q) != b.distanceCache(p,q)))
+      return false;
+  return true;
+}
+
+//! makeVisibility on 1 to 64 threads, with both engines, speedup over the serial build
+void bench_visthreads()
+{
+  cout << "map\tvertices\tengine\tthreads\tms\tspeedup" << endl;
+
+  char const * names[] = { "squares", "clutter" };
+  char const * engines[] = { "pairs", "sweep" };
+  int sizes[] = { 400, 1600 };
+  int counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  for(int kind = 0; kind < DIM(names); ++kind)
+  for(int e = 0; e < DIM(engines); ++e)
+  {
+    World serial;
+    makeBitangentMap(serial, kind, sizes[i]);
+    serial.visibilityEngine = e ? World::VISIBILITY_SWEEP : World::VISIBILITY_PAIRS;
+
+    Timer t;
+    serial.makeVisibility();
+    double single = t.elapsed();
+    cout << names[kind] << '\t' << serial.gvertices.size() << '\t' << engines[e] << "\tserial\t" << single * 1e3 << "\t1" << endl;
+
+    for(int c = 0; c < DIM(counts); ++c)
+    {
+      WorkerPool pool(counts[c]);
+      World world;
+      world.gshapes = serial.gshapes;
+      world.gvertices = serial.gvertices;
+      world.startarea = serial.startarea;
+      world.goalarea = serial.goalarea;
+      world.visibilityEngine = serial.visibilityEngine;
+      world.workers = &pool;
+
+      t.restart();
+      world.makeVisibility();
+      double seconds = t.elapsed();
+
+      if (!sameGraph(serial, world))
+        BARF("parallel visibility graph differs from the serial one");
+
+      cout << names[kind] << '\t' << serial.gvertices.size() << '\t' << engines[e] << '\t' << counts[c] << '\t'
+           << seconds * 1e3 << '\t' << single / seconds << endl;
+    }
+  }
+}
+
+//! Edge table against the uniform grid, per segment query and for makeVisibility
+void bench_grid()
+{
+  typedef World::WPoint WPoint;
+  const int QUERIES = 2000;
+
+  cout << "edges\tcells\tbuild ms\tquery\ttable us\tgrid us\tblocked" << endl;
+  long sizes[] = { 1000, 10000, 50000, 200000 };
+  for(int i = 0; i < DIM(sizes); ++i)
+  {
+    World world;
+    makeWorld(world, sizes[i]);
+    world.growShapes(1.0);
+
+    EdgeTable edges;
+    edges.assign(world.gvertices, world.gshapes);
+
+    Timer t;
+    EdgeGrid grid;
+    grid.assign(world.gvertices, world.gshapes);
+    double build = t.elapsed();
+
+    // segments to a vertex of a nearby shape, which are mostly clear, and
+    // between random vertices, which are mostly blocked
+    char const * kinds[] = { "near", "random" };
+    for(int k = 0; k < DIM(kinds); ++k)
+    {
+      vector<WPoint> from, to;
+      unsigned seed = 54321;
+      int nv = world.gvertices.size();
+      for(int q = 0; q < QUERIES; ++q)
+      {
+        seed = seed * 1103515245 + 12345;
+        int p = (seed >> 8) % nv;
+        seed = seed * 1103515245 + 12345;
+        int r = k == 0 ? (p + 4 + (seed >> 8) % 8) % nv : (seed >> 8) % nv;
+        from.push_back(world.gvertices[p]);
+        to.push_back(world.gvertices[r]);
+      }
+
+      t.restart();
+      long a = 0;
+      for(int q = 0; q < QUERIES; ++q)
+        a += edges.intersects(from[q], to[q]);
+      double table = t.elapsed() / QUERIES * 1e6;
+
+      EdgeGrid::Visits visits;
+      t.restart();
+      long b = 0;
+      for(int q = 0; q < QUERIES; ++q)
+        b += grid.intersects(from[q], to[q], visits);
+      double gridded = t.elapsed() / QUERIES * 1e6;
+
+      if (a != b)
+        BARF("grid results differ from the edge table");
+
+      cout << grid.size() << '\t' << (long)grid.columns() * grid.rowCount() << '\t' << build * 1e3 << '\t' << kinds[k] << '\t'
+           << table << '\t' << gridded << '\t' << a << endl;
+    }
+  }
+
+  cout << endl << "map\tvertices\tpairs ms\tgrid ms" << endl;
+  char const * names[] = { "squares", "clutter", "merged", "grid" };
+  int vertices[] = { 400, 1600 };
+  for(int i = 0; i < DIM(vertices); ++i)
+  for(int kind = 0; kind < DIM(names); ++kind)
+  {
+    World pairs, gridded;
+    makeBitangentMap(pairs, kind, vertices[i]);
+    makeBitangentMap(gridded, kind, vertices[i]);
+    gridded.visibilityEngine = World::VISIBILITY_GRID;
+
+    Timer t;
+    pairs.makeVisibility();
+    double a = t.elapsed();
+
+    t.restart();
+    gridded.makeVisibility();
+    double b = t.elapsed();
+
+    if (!sameGraph(pairs, gridded))
+      BARF("grid engine gives a different visibility graph");
+
+    cout << names[kind] << '\t' << pairs.gvertices.size() << '\t' << a * 1e3 << '\t' << b * 1e3 << endl;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////// MAIN
+
+struct Benchmark
+{
+  char const * name;
+  void (*run)();
+  char const * description;
+};
+
+Benchmark benchmarks[] =
+{
+  { "parse", bench_parse, "obstacle file parsing throughput" },
+  { "output", bench_output, "visibility graph output throughput" },
+  { "pparse", bench_pparse, "parallel obstacle file parsing, 1 to N threads" },
+  { "orient", bench_orient, "orientation test per call and per visibility build" },
+  { "edges", bench_edges, "segment against all obstacle edges, 1k to 50k edges" },
+  { "tables", bench_tables, "planner loops on structs vs flat tables, with cache misses" },
+  { "hull", bench_hull, "convex hull of grown obstacles, graham scan vs monotone chain" },
+  { "grow", bench_grow, "growShapes engines, point cloud hull vs Minkowski sum" },
+  { "coords", bench_coords, "int32, int64, float, double and fixed point coordinates" },
+  { "merge", bench_merge, "overlapping grown shapes, all pairs vs sweep and prune" },
+  { "slices", bench_slices, "planning with configuration space slices for 1 to 16 headings" },
+  { "growthreads", bench_growthreads, "growShapes and fgrowShapes on 1 to N threads, 10k and 40k obstacles" },
+  { "growcache", bench_growcache, "regrowing a map with 5% of the obstacles moved, with the grow cache" },
+  { "sweep", bench_sweep, "planning for 16 grow multipliers, serial and on 1 to N threads" },
+  { "visweep", bench_visweep, "makeVisibility by rotational sweep vs every pair, up to 100k vertices" },
+  { "bitangent", bench_bitangent, "full visibility graph vs bitangent edges only, edges and findPath time" },
+  { "visthreads", bench_visthreads, "makeVisibility on 1 to 64 threads, balanced row runs, both engines" },
+  { "grid", bench_grid, "segment queries and makeVisibility, edge table vs uniform grid" }
+};
+
+int main(int argc, char ** argv)
+{
+  try
+  {
+    for(int b = 0; b < DIM(benchmarks); ++b)
+    {
+      bool selected = argc <= 1;
+      for(int a = 1; a < argc; ++a)
+        if (strcmp(argv[a], benchmarks[b].name) == 0)
+          selected = true;
+
+      if (selected)
+      {
+        cout << "# " << benchmarks[b].name << ": " << benchmarks[b].description << endl;
+        benchmarks[b].run();
+        cout << endl;
+      }
+    }
+  }
+  catch(SimpleException e)
+  {
+    cerr << "Exception '" << e.text << "' in " << e.file << ":" << e.line << endl;
+    return 1;
+  }
+  return 0;
+}
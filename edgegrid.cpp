@@ -0,0 +1,217 @@
+#include "edgegrid.h"
+
+#include <algorithm>
+#include <math.h>
+
+using std::min;
+using std::max;
+
+/*
+
+Which edges a query has to test
+
+linesIntersect(P, Q, R, S) is true when neither segment has both ends of
+the other on one side of it, where points on the other's line count as
+on both sides, except on horizontal lines. When PQ isn't horizontal
+that only happens when the segments meet, so the edge passes through a
+cell PQ passes through. The same goes for the edges that aren't
+horizontal when PQ is.
+
+For a horizontal PQ, line_rside only counts P itself as on the line, so
+a horizontal edge (or one with both ends at the same point) anywhere on
+the same line blocks it, however far apart they are. EdgeTable gives the
+same answer, so the grid keeps those edges sorted by height too, and a
+horizontal query tests the ones at its height.
+
+
+Walking the cells
+
+The grid goes row by row from P's row to Q's, and in each row through
+the run of cells the segment passes through in that row's height band,
+in the direction from P to Q. Edges are put into cells the same way when
+the grid is built. Bands are closed and the runs are widened by a small
+margin against rounding, so a point both segments pass through is in a
+cell of both. A run can take a cell the segment only grazes, which costs
+a few edge tests and never changes an answer.
+
+An edge crossing several cells is listed in each, so every query takes
+a new stamp and marks the edges it tests with it.
+
+*/
+
+namespace
+{
+  typedef _Point_wide<World::coord>::type wide;
+}
+
+EdgeGrid::EdgeGrid() : ox(0), oy(0), cell(1), cols(0), rows(0)
+{
+}
+
+int EdgeGrid::row(coord y) const
+{
+  wide d = (wide)y - oy;
+  if (d < 0)
+    return -1;
+  return d / cell < rows ? (int)(d / cell) : rows;
+}
+
+bool EdgeGrid::span(WPoint A, WPoint B, int r, int & c0, int & c1) const
+{
+  double lo = (double)oy + (double)r * cell, hi = lo + cell;
+  double y0 = max(lo, (double)min(A.y, B.y)), y1 = min(hi, (double)max(A.y, B.y));
+  if (y0 > y1)
+    return false;
+
+  double x0 = min(A.x, B.x), x1 = max(A.x, B.x);
+  if (A.y != B.y)
+  {
+    double slope = ((double)B.x - A.x) / ((double)B.y - A.y);
+    x0 = A.x + (y0 - A.y) * slope;
+    x1 = A.x + (y1 - A.y) * slope;
+    if (x0 > x1)
+      std::swap(x0, x1);
+  }
+
+  double margin = 1e-9 * (fabs(x0) + fabs(x1) + cell);
+  double left = floor((x0 - margin - ox) / cell), right = floor((x1 + margin - ox) / cell);
+  if (right < 0 || left >= cols)
+    return false;
+  c0 = left < 0 ? 0 : (int)left;
+  c1 = right >= cols ? cols - 1 : (int)right;
+  return true;
+}
+
+void EdgeGrid::assign(vector<World::GVertex> const & vertices, vector<World::Shape> const & shapes)
+{
+  from.resize(0);
+  to.resize(0);
+  level.resize(0);
+
+  coord xmin = 0, xmax = 0, ymin = 0, ymax = 0;
+  for(size_t s = 0; s < shapes.size(); ++s)
+  {
+    int sv = shapes[s].startidx;
+    int nv = shapes[s].vertices;
+    for(int e = 0; e < nv; ++e)
+    {
+      WPoint R = vertices[sv + e];
+      WPoint S = vertices[sv + (e + 1) % nv];
+      if (from.empty())
+      {
+        xmin = xmax = R.x;
+        ymin = ymax = R.y;
+      }
+      xmin = min(xmin, R.x); xmax = max(xmax, R.x);
+      ymin = min(ymin, R.y); ymax = max(ymax, R.y);
+      if (R.y == S.y)
+        level.push_back(std::make_pair(R.y, (int)from.size()));
+      from.push_back(R);
+      to.push_back(S);
+    }
+  }
+  std::sort(level.begin(), level.end());
+
+  int n = from.size();
+  double width = (double)xmax - xmin + 1, height = (double)ymax - ymin + 1;
+
+  // about one cell per edge, and no more than one row or column per
+  // edge on long thin maps
+  cell = max((wide)1, (wide)ceil(sqrt(width * height / max(n, 1))));
+  cell = max(cell, (wide)ceil(max(width, height) / (n + 1)));
+  ox = xmin;
+  oy = ymin;
+  cols = (int)((((wide)xmax - xmin) / cell) + 1);
+  rows = (int)((((wide)ymax - ymin) / cell) + 1);
+  if (!n)
+    cols = rows = 0;
+
+  // count the cells of each edge, then fill them in
+  first.assign((size_t)cols * rows + 1, 0);
+  for(int pass = 0; pass < 2; ++pass)
+  {
+    for(int e = 0; e < n; ++e)
+    {
+      int r0 = row(min(from[e].y, to[e].y)), r1 = row(max(from[e].y, to[e].y));
+      for(int r = r0; r <= r1; ++r)
+      {
+        int c0, c1;
+        if (!span(from[e], to[e], r, c0, c1))
+          continue;
+        for(int c = c0; c <= c1; ++c)
+        {
+          size_t k = (size_t)r * cols + c;
+          if (pass == 0)
+            ++first[k + 1];
+          else
+            edges[first[k]++] = e;
+        }
+      }
+    }
+
+    if (pass == 0)
+    {
+      for(size_t k = 1; k < first.size(); ++k)
+        first[k] += first[k - 1];
+      edges.resize(first.back());
+    }
+    else
+    {
+      // filling moved each start to the next cell's
+      for(size_t k = first.size() - 1; k > 0; --k)
+        first[k] = first[k - 1];
+      first[0] = 0;
+    }
+  }
+}
+
+bool EdgeGrid::test(WPoint P, WPoint Q, int e, Visits & visits) const
+{
+  if (visits.stamp[e] == visits.now)
+    return false;
+  visits.stamp[e] = visits.now;
+  return linesIntersect(P, Q, from[e], to[e]);
+}
+
+bool EdgeGrid::intersects(WPoint P, WPoint Q, Visits & visits) const
+{
+  if (visits.stamp.size() != from.size() || visits.now == ~0u)
+  {
+    visits.stamp.assign(from.size(), 0);
+    visits.now = 0;
+  }
+  ++visits.now;
+
+  if (P.y == Q.y)
+  {
+    typedef vector<std::pair<coord, int> >::const_iterator ilevel;
+    ilevel i = std::lower_bound(level.begin(), level.end(), std::make_pair(P.y, -1));
+    for(; i != level.end() && i->first == P.y; ++i)
+      if (test(P, Q, i->second, visits))
+        return true;
+  }
+
+  int rp = row(P.y), rq = row(Q.y);
+  int step = rq >= rp ? 1 : -1;
+  bool right = Q.x >= P.x;
+  for(int r = rp; ; r += step)
+  {
+    if (r >= 0 && r < rows)
+    {
+      int c0, c1;
+      if (span(P, Q, r, c0, c1))
+      {
+        for(int i = 0; i <= c1 - c0; ++i)
+        {
+          size_t k = (size_t)r * cols + (right ? c0 + i : c1 - i);
+          for(int j = first[k]; j < first[k + 1]; ++j)
+            if (test(P, Q, edges[j], visits))
+              return true;
+        }
+      }
+    }
+    if (r == rq)
+      break;
+  }
+  return false;
+}
@@ -0,0 +1,85 @@
+#ifndef edgegrid_h
+#define edgegrid_h
+
+#include "world.h"
+
+/*! Uniform grid over the grown obstacle edges
+
+   Each cell lists the edges that pass through it. intersects(P, Q) walks
+   only the cells segment PQ passes through, starting at P, tests each
+   edge there once and stops at the first hit, so on maps where the
+   obstacles are spread out a query costs about the number of cells it
+   crosses instead of the number of edges. The cell size is picked so
+   there are about as many cells as edges.
+
+   The answers are the same as EdgeTable::intersects, including the
+   horizontal segments linesIntersect counts as blocked by distant edges
+   on the same line, see edgegrid.cpp.
+*/
+class EdgeGrid
+{
+public:
+  typedef World::coord coord;
+  typedef World::WPoint WPoint;
+
+  //! edges already tested by the current query. one per thread
+  class Visits
+  {
+  public:
+    Visits() : now(0) { }
+
+  private:
+    friend class EdgeGrid;
+    vector<unsigned> stamp;
+    unsigned now;
+  };
+
+  EdgeGrid();
+
+  //! load the edges of a set of shapes and size the grid to them
+  void assign(vector<World::GVertex> const & vertices, vector<World::Shape> const & shapes);
+
+  //! true if segment PQ intersects any edge, the same as EdgeTable::intersects
+  bool intersects(WPoint P, WPoint Q, Visits & visits) const;
+
+  size_t size() const
+  {
+    return from.size();
+  }
+
+  int columns() const
+  {
+    return cols;
+  }
+
+  int rowCount() const
+  {
+    return rows;
+  }
+
+private:
+  //! edge i goes from from[i] to to[i]
+  vector<WPoint> from, to;
+
+  //! lower left corner of the grid, and the side of a cell
+  coord ox, oy;
+  long long cell;
+  int cols, rows;
+
+  //! edges in cell c are edges[first[c]] through edges[first[c+1]-1], cells row by row
+  vector<int> first;
+  vector<int> edges;
+
+  //! edges with both ends at the same height, by that height
+  vector<std::pair<coord, int> > level;
+
+  //! row of height y, -1 below the grid and rows above it
+  int row(coord y) const;
+
+  //! cells of row r that segment AB passes through, maybe one more at either end. false if none
+  bool span(WPoint A, WPoint B, int r, int & c0, int & c1) const;
+
+  bool test(WPoint P, WPoint Q, int e, Visits & visits) const;
+};
+
+#endif
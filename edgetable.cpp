@@ -0,0 +1,348 @@
+#include "edgetable.h"
+
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EDGETABLE_AVX2
+#include <immintrin.h>
+#endif
+
+/*
+
+AVX2 kernel
+
+Four edges go in each register, two registers per loop iteration. The
+integer coordinates are converted to doubles as they are loaded. For
+query segment PQ and edge RS the kernel computes the four cross products
+
+  c1 = (Q - P) x (R - P)      c3 = (S - R) x (P - R)
+  c2 = (Q - P) x (S - P)      c4 = (S - R) x (Q - R)
+
+in doubles. They are exact when coordinates stay below 2^24, which the
+table checks for. When all four are nonzero, line_rside returns a single
+side flag for each, and linesIntersect reduces to c1 * c2 < 0 and
+c3 * c4 < 0. An edge where either product is positive can't intersect.
+The remaining lanes, where one of the points is collinear with the other
+segment, are rare and are passed to the scalar linesIntersect so the
+special cases match exactly.
+
+
+Hull search
+
+The grown shapes are convex hulls, so most of their edges can be ruled
+out without testing them. A shape whose bounding box misses the segment
+is skipped.
+
+For any other segment PQ that isn't horizontal, line_rside never returns
+0, so linesIntersect(P, Q, R, S) can only be true when R and S are
+strictly on opposite sides of the line through P and Q. An edge that
+merely touches the line at a vertex doesn't block, which is what lets
+visibility edges run along hull vertices. Going around a convex polygon,
+the cross product f(V) = (Q - P) x (V - P) rises from its minimum vertex
+to its maximum and falls back again, so at most two edges change sign.
+
+The minimum and maximum vertices are found by binary search on the edge
+directions, which turn counterclockwise around the hull. The maximum is
+at the start of the first edge pointing at or past P - Q, and the
+minimum at the start of the first edge pointing at or past Q - P. Then a
+binary search on each of the two chains finds where f changes sign, and
+only those edges get the full linesIntersect test. Everything uses exact
+integer arithmetic.
+
+Horizontal segments follow different rules. linesIntersect reports an
+intersection when all four points lie on one horizontal line, even if
+the segments are apart. Those segments keep the bounding box test in y
+only and test every edge of the shape. So do shapes that aren't strictly
+convex.
+
+*/
+
+namespace
+{
+  typedef _Point_wide<World::coord>::type wide;
+
+  //! compares directions by counterclockwise angle from a reference direction
+  struct AngleOrder
+  {
+    wide rx, ry;
+
+    AngleOrder(wide rx_, wide ry_) : rx(rx_), ry(ry_) { }
+
+    //! 0 for angles in [0, PI), 1 for [PI, 2 PI)
+    int half(wide x, wide y) const
+    {
+      wide c = _Point_cross<wide>(rx, ry, x, y);
+      return !(c > 0 || (c == 0 && rx * x + ry * y > 0));
+    }
+
+    bool less(wide ax, wide ay, wide bx, wide by) const
+    {
+      int ha = half(ax, ay), hb = half(bx, by);
+      return ha != hb ? ha < hb : _Point_cross<wide>(ax, ay, bx, by) > 0;
+    }
+  };
+}
+
+EdgeTable::EdgeTable() : exact(true), current(HULLS)
+{
+}
+
+void EdgeTable::assign(vector<World::GVertex> const & vertices, vector<World::Shape> const & shapes)
+{
+  x.resize(0); y.resize(0);
+  dx.resize(0); dy.resize(0);
+  shapeno.resize(0);
+  first.resize(0);
+  xmin.resize(0); xmax.resize(0);
+  ymin.resize(0); ymax.resize(0);
+  convex.resize(0);
+  exact = true;
+
+  for(size_t i = 0; i < shapes.size(); ++i)
+  {
+    int sv = shapes[i].startidx;
+    int nv = shapes[i].vertices;
+    first.push_back(x.size());
+    xmin.push_back(nv ? vertices[sv].x : 0); xmax.push_back(xmin.back());
+    ymin.push_back(nv ? vertices[sv].y : 0); ymax.push_back(ymin.back());
+
+    for(int e = 0; e < nv; ++e)
+    {
+      WPoint R = vertices[sv + e];
+      WPoint S = vertices[sv + (e + 1) % nv];
+      x.push_back(R.x); y.push_back(R.y);
+      dx.push_back(S.x - R.x); dy.push_back(S.y - R.y);
+      shapeno.push_back(i);
+      exact = exact && _Point_small(R);
+
+      xmin.back() = min(xmin.back(), R.x); xmax.back() = max(xmax.back(), R.x);
+      ymin.back() = min(ymin.back(), R.y); ymax.back() = max(ymax.back(), R.y);
+    }
+
+    // every turn is to the left, and the directions go around only once
+    int b = first.back();
+    bool isconvex = nv >= 3;
+    AngleOrder order(dx[b], dy[b]);
+    for(int e = 0; e < nv && isconvex; ++e)
+    {
+      int i0 = b + e, i1 = b + (e + 1) % nv;
+      isconvex = _Point_cross<wide>(dx[i0], dy[i0], dx[i1], dy[i1]) > 0
+        && (e == nv - 1 || order.less(dx[i0], dy[i0], dx[i1], dy[i1]));
+    }
+    convex.push_back(isconvex);
+  }
+  first.push_back(x.size());
+}
+
+bool EdgeTable::inside(WPoint P) const
+{
+  size_t n = size();
+  for(size_t i = 0; i < n; )
+  {
+    int s = shapeno[i];
+    while (i < n && shapeno[i] == s && P.line_rside(from(i), to(i)) == WPoint::LEFT_SIDE)
+      ++i;
+    if (i == n || shapeno[i] != s) // left of every edge
+      return true;
+    while (i < n && shapeno[i] == s)
+      ++i;
+  }
+  return false;
+}
+
+EdgeTable::Kernel EdgeTable::bestKernel()
+{
+#ifdef EDGETABLE_AVX2
+  static Kernel best = (__builtin_cpu_init(), __builtin_cpu_supports("avx2")) ? AVX2 : SCALAR;
+  return best;
+#else
+  return SCALAR;
+#endif
+}
+
+void EdgeTable::setKernel(Kernel k)
+{
+  current = k == AVX2 ? bestKernel() : k;
+}
+
+bool EdgeTable::intersects(WPoint P, WPoint Q) const
+{
+  if (current == HULLS)
+    return intersectsHulls(P, Q);
+  if (current == AVX2 && exact && _Point_small(P) && _Point_small(Q))
+    return intersectsAVX2(P, Q);
+  return intersectsScalar(P, Q, 0, size());
+}
+
+bool EdgeTable::intersectsScalar(WPoint P, WPoint Q, size_t begin, size_t end) const
+{
+  for(size_t i = begin; i < end; ++i)
+    if (linesIntersect(P, Q, from(i), to(i)))
+      return true;
+  return false;
+}
+
+bool EdgeTable::intersectsHulls(WPoint P, WPoint Q) const
+{
+  coord left = min(P.x, Q.x), right = max(P.x, Q.x);
+  coord bottom = min(P.y, Q.y), top = max(P.y, Q.y);
+  bool horizontal = P.y == Q.y;
+
+  size_t shapes = convex.size();
+  for(size_t s = 0; s < shapes; ++s)
+  {
+    if (ymin[s] > top || ymax[s] < bottom)
+      continue;
+
+    if (horizontal || !convex[s])
+    {
+      if (intersectsScalar(P, Q, first[s], first[s+1]))
+        return true;
+    }
+    else if (xmin[s] <= right && xmax[s] >= left && intersectsHull(P, Q, s))
+      return true;
+  }
+  return false;
+}
+
+bool EdgeTable::intersectsHull(WPoint P, WPoint Q, size_t s) const
+{
+  int b = first[s];
+  int n = first[s+1] - b;
+  wide ux = (wide)Q.x - P.x, uy = (wide)Q.y - P.y;
+  AngleOrder order(dx[b], dy[b]);
+
+  // first edge at or counterclockwise past each direction
+  int lo[2] = { 0, 0 }, hi[2] = { n, n };
+  wide tx[2] = { -ux, ux }, ty[2] = { -uy, uy };
+  for(int k = 0; k < 2; ++k)
+  {
+    while (lo[k] < hi[k])
+    {
+      int mid = (lo[k] + hi[k]) / 2;
+      if (order.less(dx[b+mid], dy[b+mid], tx[k], ty[k]))
+        lo[k] = mid + 1;
+      else
+        hi[k] = mid;
+    }
+  }
+  int highest = lo[0] % n, lowest = lo[1] % n;
+
+  // which side of PQ vertex v is on, and how far
+  auto f = [&](int v) { return _Point_cross<wide>(ux, uy, (wide)x[b + v % n] - P.x, (wide)y[b + v % n] - P.y); };
+
+  if (f(highest) <= 0 || f(lowest) >= 0) // all on one side
+    return false;
+
+  // rising chain from lowest to highest, then falling chain back
+  int chains[2][2] = { { lowest, highest }, { highest, lowest } };
+  for(int k = 0; k < 2; ++k)
+  {
+    int start = chains[k][0];
+    int below = 0, above = (chains[k][1] - start + n) % n;
+    while (above - below > 1)
+    {
+      int mid = (below + above) / 2;
+      if ((f(start + mid) < 0) == (k == 0))
+        below = mid;
+      else
+        above = mid;
+    }
+    int e = b + (start + below) % n;
+    if (linesIntersect(P, Q, from(e), to(e)))
+      return true;
+  }
+
+  return false;
+}
+
+#ifdef EDGETABLE_AVX2
+
+namespace
+{
+  //! lanes that may intersect, and lanes that certainly do
+  struct AVX2Masks
+  {
+    int maybe, sure;
+  };
+
+  __attribute__((target("avx2")))
+  inline __m256d load(World::coord const * p)
+  {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128((__m128i const *)p));
+  }
+
+  __attribute__((target("avx2")))
+  inline AVX2Masks testEdges(__m256d px, __m256d py, __m256d qx, __m256d qy, __m256d dx, __m256d dy,
+    World::coord const * rx, World::coord const * ry, World::coord const * edx, World::coord const * edy)
+  {
+    __m256d Rx = load(rx), Ry = load(ry);
+    __m256d ex = load(edx), ey = load(edy);
+    __m256d Sx = _mm256_add_pd(Rx, ex), Sy = _mm256_add_pd(Ry, ey);
+
+    __m256d c1 = _mm256_sub_pd(_mm256_mul_pd(dx, _mm256_sub_pd(Ry, py)), _mm256_mul_pd(dy, _mm256_sub_pd(Rx, px)));
+    __m256d c2 = _mm256_sub_pd(_mm256_mul_pd(dx, _mm256_sub_pd(Sy, py)), _mm256_mul_pd(dy, _mm256_sub_pd(Sx, px)));
+
+    __m256d c3 = _mm256_sub_pd(_mm256_mul_pd(ex, _mm256_sub_pd(py, Ry)), _mm256_mul_pd(ey, _mm256_sub_pd(px, Rx)));
+    __m256d c4 = _mm256_sub_pd(_mm256_mul_pd(ex, _mm256_sub_pd(qy, Ry)), _mm256_mul_pd(ey, _mm256_sub_pd(qx, Rx)));
+
+    __m256d a = _mm256_mul_pd(c1, c2), b = _mm256_mul_pd(c3, c4);
+    __m256d zero = _mm256_setzero_pd();
+
+    AVX2Masks m;
+    m.maybe = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(a, zero, _CMP_LE_OQ), _mm256_cmp_pd(b, zero, _CMP_LE_OQ)));
+    m.sure = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(a, zero, _CMP_LT_OQ), _mm256_cmp_pd(b, zero, _CMP_LT_OQ)));
+    return m;
+  }
+}
+
+__attribute__((target("avx2")))
+bool EdgeTable::intersectsAVX2(WPoint P, WPoint Q) const
+{
+  __m256d px = _mm256_set1_pd(P.x), py = _mm256_set1_pd(P.y);
+  __m256d qx = _mm256_set1_pd(Q.x), qy = _mm256_set1_pd(Q.y);
+  __m256d qdx = _mm256_set1_pd((double)Q.x - P.x), qdy = _mm256_set1_pd((double)Q.y - P.y);
+
+  size_t n = size();
+  size_t i = 0;
+  for(; i + 8 <= n; i += 8)
+  {
+    AVX2Masks lo = testEdges(px, py, qx, qy, qdx, qdy, &x[i], &y[i], &dx[i], &dy[i]);
+    AVX2Masks hi = testEdges(px, py, qx, qy, qdx, qdy, &x[i+4], &y[i+4], &dx[i+4], &dy[i+4]);
+    if (lo.sure | hi.sure)
+      return true;
+
+    int maybe = lo.maybe | hi.maybe << 4;
+    for(int lane = 0; maybe; ++lane, maybe >>= 1)
+      if ((maybe & 1) && linesIntersect(P, Q, from(i + lane), to(i + lane)))
+        return true;
+  }
+  return intersectsScalar(P, Q, i, n);
+}
+
+#else
+
+bool EdgeTable::intersectsAVX2(WPoint P, WPoint Q) const
+{
+  return intersectsScalar(P, Q, 0, size());
+}
+
+#endif
+
+void NodeTable::assign(World & world)
+{
+  size_t n = world.nodes.size();
+  x.resize(n);
+  y.resize(n);
+  shapeno.resize(n);
+  for(size_t i = 0; i < n; ++i)
+  {
+    World::GVertex const & v = world.get_node(i);
+    x[i] = v.x;
+    y[i] = v.y;
+    shapeno[i] = v.shapeno;
+  }
+}
@@ -0,0 +1,120 @@
+#ifndef edgetable_h
+#define edgetable_h
+
+#include "world.h"
+
+/*! Flat table of grown obstacle edges
+
+   The visibility loops test one segment against every obstacle edge.
+   This table stores the edges as separate arrays of start points,
+   direction vectors and shape numbers, in shape order, so the loops
+   stream through contiguous memory instead of rebuilding each edge from
+   the shape array with modular arithmetic.
+
+   intersects(P, Q) gives the same answer as calling linesIntersect on
+   each edge in turn. The default HULLS kernel skips shapes whose bounding
+   box misses the segment and searches the rest in O(log n), see
+   edgetable.cpp. The AVX2 and SCALAR kernels test every edge.
+*/
+class EdgeTable
+{
+public:
+  typedef World::coord coord;
+  typedef World::WPoint WPoint;
+
+  enum Kernel { SCALAR, AVX2, HULLS };
+
+  EdgeTable();
+
+  //! load the edges of a set of shapes, in shape order
+  void assign(vector<World::GVertex> const & vertices, vector<World::Shape> const & shapes);
+
+  //! true if segment PQ intersects any edge. stops at the first hit
+  bool intersects(WPoint P, WPoint Q) const;
+
+  //! true if P is strictly inside one of the shapes, which must be counterclockwise
+  bool inside(WPoint P) const;
+
+  size_t size() const
+  {
+    return x.size();
+  }
+
+  //! fastest edge by edge kernel supported by this processor
+  static Kernel bestKernel();
+
+  //! select a kernel, for comparisons. AVX2 falls back to SCALAR if unsupported
+  void setKernel(Kernel k);
+
+  Kernel kernel() const
+  {
+    return current;
+  }
+
+private:
+  //! edge i goes from (x[i], y[i]) to (x[i] + dx[i], y[i] + dy[i])
+  vector<coord> x, y, dx, dy;
+
+  //! index of the shape each edge belongs to
+  vector<int> shapeno;
+
+  //! edges of shape s are first[s] through first[s+1]-1
+  vector<int> first;
+
+  //! shape bounding boxes
+  vector<coord> xmin, xmax, ymin, ymax;
+
+  //! true for shapes that are strictly convex and counterclockwise
+  vector<bool> convex;
+
+  //! true if every coordinate is small enough for exact cross products in doubles
+  bool exact;
+
+  Kernel current;
+
+  WPoint from(size_t i) const
+  {
+    return WPoint(x[i], y[i]);
+  }
+
+  WPoint to(size_t i) const
+  {
+    return WPoint(x[i] + dx[i], y[i] + dy[i]);
+  }
+
+  bool intersectsScalar(WPoint P, WPoint Q, size_t begin, size_t end) const;
+  bool intersectsAVX2(WPoint P, WPoint Q) const;
+  bool intersectsHulls(WPoint P, WPoint Q) const;
+  bool intersectsHull(WPoint P, WPoint Q, size_t s) const;
+};
+
+/*! Visibility graph nodes as flat arrays
+
+   Entry i holds the position and shape number of get_node(i), with the
+   start and goal points filled in, so the planner loops don't branch on
+   START and GOAL for every access.
+*/
+class NodeTable
+{
+public:
+  typedef World::coord coord;
+  typedef World::WPoint WPoint;
+
+  vector<coord> x, y;
+  vector<int> shapeno;
+
+  //! copy the world's nodes. call again after start or goal move
+  void assign(World & world);
+
+  WPoint operator[](size_t i) const
+  {
+    return WPoint(x[i], y[i]);
+  }
+
+  size_t size() const
+  {
+    return x.size();
+  }
+};
+
+#endif
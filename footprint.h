@@ -0,0 +1,64 @@
+#ifndef footprint_h
+#define footprint_h
+
+/*! Robot outline fixed at compile time
+
+   XY lists the corners as x, y pairs, counterclockwise, followed by the
+   robot's reference point. convex() checks at compile time that the
+   corners are strictly convex, and World::robot is sized and filled from
+   PioneerFootprint, so the outline is written down in one place.
+*/
+template<int... XY>
+struct Footprint
+{
+  enum { CORNERS = sizeof...(XY) / 2 - 1 };
+
+  static constexpr int xy[sizeof...(XY)] = { XY... };
+
+  //! corner i, or the reference point for i == CORNERS
+  static constexpr int x(int i) { return xy[2 * i]; }
+  static constexpr int y(int i) { return xy[2 * i + 1]; }
+
+  //! fill points laid out like World::robot, the corners then the reference point. false if n doesn't fit
+  template<class PointType>
+  static bool copy(PointType * points, int n)
+  {
+    if (n != CORNERS + 1) return false;
+    for(int i = 0; i < n; ++i)
+      points[i] = PointType(x(i), y(i));
+    return true;
+  }
+
+  //! corners turn left everywhere and go around once
+  static constexpr bool convex()
+  {
+    return leftTurns() && windings() == 1;
+  }
+
+  static_assert(sizeof...(XY) % 2 == 0, "footprint needs x, y pairs");
+  static_assert(CORNERS >= 3, "footprint needs at least three corners and a reference point");
+
+private:
+  static constexpr long long edgex(int i) { return (long long)x((i + 1) % CORNERS) - x(i % CORNERS); }
+  static constexpr long long edgey(int i) { return (long long)y((i + 1) % CORNERS) - y(i % CORNERS); }
+
+  //! every corner is a strict left turn
+  static constexpr bool leftTurns(int i = 0)
+  {
+    return i == CORNERS || (edgex(i) * edgey(i + 1) - edgey(i) * edgex(i + 1) > 0 && leftTurns(i + 1));
+  }
+
+  //! times the edge direction turns up through +x. left turns all the way around pass it once
+  static constexpr int windings(int i = 0)
+  {
+    return i == CORNERS ? 0 : (edgey(i) < 0 && edgey(i + 1) >= 0) + windings(i + 1);
+  }
+};
+
+template<int... XY>
+constexpr int Footprint<XY...>::xy[sizeof...(XY)];
+
+// These were the dimensions given, but the pioneer robot in the saphira module is larger
+typedef Footprint<0,0, 370,0, 370,550, 0,550, 185,275> PioneerFootprint;
+
+#endif
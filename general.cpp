@@ -2,6 +2,15 @@
 
 #include <iostream>
 
+#if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using std::cerr;
 using std::endl;
 
@@ -10,3 +19,98 @@ void SimpleException::print()
   cerr << "Exception '" << text.c_str() << "' in " << file << ":" << line << endl;
   BARF("ok");
 }
+
+void writeSection(FILE * fp, void const * data, size_t size)
+{
+  static const char zeros[8] = { 0 };
+  if (size > 0 && fwrite(data, 1, size, fp) != size)
+    BARF("File write failed");
+  if (fwrite(zeros, 1, padded(size) - size, fp) != padded(size) - size)
+    BARF("File write failed");
+}
+
+MappedFile::MappedFile(char const * filename)
+: data(NULL), length(0), mapped(false)
+{
+#ifdef HAVE_MMAP
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    BARF(string("File ") + filename + " doesn't open.");
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+  {
+    length = st.st_size;
+    if (length == 0) // nothing to map
+    {
+      close(fd);
+      return;
+    }
+    void * p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED)
+    {
+      madvise(p, length, MADV_SEQUENTIAL);
+      data = (char const *)p;
+      mapped = true;
+      close(fd);
+      return;
+    }
+  }
+  close(fd);
+#endif
+
+  // no mmap, or not a regular file. read the whole thing instead
+  CFile file(filename, "rb");
+  size_t capacity = 1 << 16;
+  char * buffer = new char[capacity];
+  length = 0;
+  for(;;)
+  {
+    if (length == capacity)
+    {
+      char * nbuffer = new char[capacity * 2];
+      std::copy(buffer, buffer + length, nbuffer);
+      delete[] buffer;
+      buffer = nbuffer;
+      capacity *= 2;
+    }
+    size_t n = fread(buffer + length, sizeof(char), capacity - length, file);
+    if (n == 0) break;
+    length += n;
+  }
+  data = buffer;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef HAVE_MMAP
+  if (mapped)
+  {
+    munmap((void *)data, length);
+    return;
+  }
+#endif
+  delete[] data;
+}
+
+void BufferedWriter::flush()
+{
+  size_t size = pos - buffer;
+  pos = buffer;
+  if (size > 0 && fwrite(buffer, 1, size, fp) != size)
+    BARF("File write failed");
+}
+
+void BufferedWriter::overflow(void const * data, size_t size)
+{
+  char const * p = (char const *)data;
+  while (size > 0)
+  {
+    if (pos == buffer + capacity) flush();
+    size_t n = std::min(size, (size_t)(buffer + capacity - pos));
+    std::copy(p, p + n, pos);
+    pos += n;
+    p += n;
+    size -= n;
+  }
+}
@@ -2,10 +2,13 @@
 #define general_h
 
 #include<stdio.h>
+#include<string.h>
 #include<string>
 #include<exception>
 #include<algorithm>
 #include<assert.h>
+#include<stdint.h>
+#include<vector>
 
 using std::string;
 using std::swap;
@@ -69,6 +72,159 @@ private:
   CFile & operator=(CFile const & file) { return *this; }
 };
 
+//! FNV-1a hash of a block of memory. Pass the previous result as h to hash several blocks
+inline uint64_t hashBytes(void const * data, size_t size, uint64_t h = 14695981039346656037ULL)
+{
+  unsigned char const * p = (unsigned char const *)data;
+  for(size_t i = 0; i < size; ++i)
+    h = (h ^ p[i]) * 1099511628211ULL;
+  return h;
+}
+
+/*! Read-only view of a whole file
+
+   The file is mapped into memory where the platform supports it and
+   read into a heap buffer otherwise. Either way its bytes stay available
+   between begin() and end() until the object is destroyed.
+*/
+class MappedFile
+{
+public:
+  MappedFile(char const * filename);
+  ~MappedFile();
+
+  char const * begin() const { return data; }
+  char const * end() const { return data + length; }
+  size_t size() const { return length; }
+
+private:
+  char const * data;
+  size_t length;
+  bool mapped;
+
+  MappedFile(MappedFile const & file) { }
+  MappedFile & operator=(MappedFile const & file) { return *this; }
+};
+
+/*! Binary files of whole arrays
+
+   Snapshots and grow caches store each array exactly as it is laid out
+   in memory, starting on an 8 byte boundary, so a mapped file can be
+   copied straight into vectors without any parsing.
+*/
+
+//! n rounded up to the next 8 byte boundary
+inline size_t padded(size_t n)
+{
+  return (n + 7) & ~(size_t)7;
+}
+
+//! write size bytes and zeros up to the next boundary. BARFs if the write fails
+void writeSection(FILE * fp, void const * data, size_t size);
+
+template<typename T>
+void writeVector(FILE * fp, std::vector<T> const & v)
+{
+  writeSection(fp, v.empty() ? NULL : &v[0], v.size() * sizeof(T));
+}
+
+//! copy n elements from a section at p into v, returns the next section
+template<typename T>
+char const * readVector(char const * p, std::vector<T> & v, size_t n)
+{
+  T const * begin = (T const *)p;
+  v.assign(begin, begin + n);
+  return p + padded(n * sizeof(T));
+}
+
+/*! Buffered output to a FILE *
+
+   Numbers are formatted straight into a large buffer which goes out in
+   big fwrite blocks, instead of one printf call per line. Call flush()
+   when done, the destructor writes anything left but can't report errors.
+*/
+class BufferedWriter
+{
+public:
+  BufferedWriter(FILE * fp_, size_t capacity_ = 1 << 18)
+  : fp(fp_), capacity(capacity_), buffer(new char[capacity_]), pos(buffer) { }
+
+  ~BufferedWriter()
+  {
+    if (pos != buffer) fwrite(buffer, 1, pos - buffer, fp);
+    delete[] buffer;
+  }
+
+  //! write out everything buffered so far
+  void flush();
+
+  //! raw bytes
+  void write(void const * data, size_t size)
+  {
+    if ((size_t)(buffer + capacity - pos) >= size)
+    {
+      memcpy(pos, data, size);
+      pos += size;
+    }
+    else
+      overflow(data, size);
+  }
+
+  BufferedWriter & operator<<(char c)
+  {
+    if (pos == buffer + capacity) flush();
+    *pos++ = c;
+    return *this;
+  }
+
+  BufferedWriter & operator<<(char const * text)
+  {
+    while (*text) *this << *text++;
+    return *this;
+  }
+
+  //! decimal, by hand since std::to_chars is C++17 and the tree builds as C++11
+  BufferedWriter & operator<<(long n)
+  {
+    // longest long is 20 digits and a sign
+    if (buffer + capacity - pos < 24) flush();
+
+    unsigned long u = (unsigned long)n;
+    if (n < 0)
+    {
+      *pos++ = '-';
+      u = 0UL - u;
+    }
+
+    char digits[24];
+    char * d = digits + sizeof(digits);
+    do
+    {
+      *--d = (char)('0' + u % 10);
+      u /= 10;
+    } while (u);
+
+    while (d != digits + sizeof(digits)) *pos++ = *d++;
+    return *this;
+  }
+
+  BufferedWriter & operator<<(int n)
+  {
+    return *this << (long)n;
+  }
+
+private:
+  FILE * fp;
+  size_t capacity;
+  char * buffer;
+  char * pos;
+
+  void overflow(void const * data, size_t size);
+
+  BufferedWriter(BufferedWriter const & writer) { }
+  BufferedWriter & operator=(BufferedWriter const & writer) { return *this; }
+};
+
 /*
 
 mheap functions are stl-like generic algorithms.
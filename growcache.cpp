@@ -0,0 +1,217 @@
+#include "growcache.h"
+#include "general.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+
+Cache file layout
+
+  GrowCacheHeader
+  entries, sources, points, offsets
+
+laid out like a snapshot: each array exactly as it is in memory, on an 8
+byte boundary, with a header that records the sizes of the stored
+structures and the byte order. A file written by a build that doesn't
+match is treated like a missing one.
+
+*/
+
+namespace
+{
+  const char GROWCACHE_MAGIC[8] = { 'Q', 'M', 'G', 'R', 'O', 'W', '\r', '\n' };
+  const uint32_t GROWCACHE_VERSION = 1;
+  const uint32_t GROWCACHE_BYTEORDER = 0x01020304;
+
+  enum { ENTRIES, SOURCES, POINTS, COUNTS };
+
+  struct GrowCacheHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    uint32_t sizes[2]; // coord, WPoint
+    uint64_t counts[COUNTS];
+  };
+
+  //! header must be value initialized, so the padding is zero too
+  void fillHeader(GrowCacheHeader & header)
+  {
+    memcpy(header.magic, GROWCACHE_MAGIC, sizeof(header.magic));
+    header.version = GROWCACHE_VERSION;
+    header.byteorder = GROWCACHE_BYTEORDER;
+    header.sizes[0] = sizeof(GrowCache::coord);
+    header.sizes[1] = sizeof(GrowCache::WPoint);
+  }
+}
+
+GrowCache::GrowCache()
+: hits(0), misses(0)
+{
+}
+
+uint64_t GrowCache::method(char const * name, void const * parameters, size_t size)
+{
+  uint64_t h = hashBytes(name, strlen(name));
+  return hashBytes(parameters, size, h);
+}
+
+uint64_t GrowCache::key(uint64_t method, Vertex const * vertices, int n)
+{
+  // only the coordinates, shape numbers change when obstacles are added
+  // before this one. a vertex at a time instead of hashBytes' byte at a
+  // time, which made hashing cost as much as the lookup
+  uint64_t h = method ^ (uint64_t)n;
+  for(int i = 0; i < n; ++i)
+  {
+    uint64_t xy = (uint64_t)(uint32_t)vertices[i].x << 32 | (uint32_t)vertices[i].y;
+    h = (h ^ xy) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 32;
+  }
+
+  // the slot comes from the low bits, so mix the high ones down
+  h ^= h >> 29;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  return h ^ (h >> 32);
+}
+
+size_t GrowCache::slot(uint64_t key) const
+{
+  size_t mask = slots.size() - 1;
+  size_t i = key & mask;
+  while (slots[i] && entries[slots[i] - 1].key != key)
+    i = (i + 1) & mask;
+  return i;
+}
+
+void GrowCache::rehash(size_t n)
+{
+  size_t size = 16;
+  while (size < 2 * n)
+    size *= 2;
+  slots.assign(size, 0);
+  for(size_t e = 0; e < entries.size(); ++e)
+    slots[slot(entries[e].key)] = e + 1;
+}
+
+bool GrowCache::find(uint64_t key, Vertex const * vertices, int n, int shapeno, int startidx, vector<GVertex> & out) const
+{
+  if (slots.empty())
+    return false;
+  uint32_t i = slots[slot(key)];
+  if (!i)
+    return false;
+
+  Entry const & e = entries[i - 1];
+  if (e.vertices != (uint32_t)n)
+    return false;
+  for(int v = 0; v < n; ++v)
+    if (!sources[e.source + v].equals(vertices[v]))
+      return false;
+
+  for(uint32_t g = e.grown; g < e.grown + e.gvertices; ++g)
+    out.push_back(GVertex(points[g], shapeno, startidx + offsets[g]));
+  return true;
+}
+
+void GrowCache::insert(uint64_t key, Vertex const * vertices, int n, GVertex const * grown, int ngrown, int startidx)
+{
+  if (2 * (entries.size() + 1) > slots.size())
+    rehash(entries.size() + 1);
+  size_t s = slot(key);
+  if (slots[s])
+    return; // a collision, keep the first
+
+  Entry e;
+  e.key = key;
+  e.source = sources.size();
+  e.vertices = n;
+  e.grown = points.size();
+  e.gvertices = ngrown;
+
+  sources.insert(sources.end(), vertices, vertices + n);
+  for(int g = 0; g < ngrown; ++g)
+  {
+    points.push_back(grown[g]);
+    offsets.push_back(grown[g].vertexno - startidx);
+  }
+
+  entries.push_back(e);
+  slots[s] = entries.size();
+}
+
+void GrowCache::clear()
+{
+  entries.resize(0);
+  sources.resize(0);
+  points.resize(0);
+  offsets.resize(0);
+  slots.resize(0);
+}
+
+bool GrowCache::load(char const * filename)
+{
+  clear();
+
+  FILE * probe = fopen(filename, "rb");
+  if (!probe) return false;
+  fclose(probe);
+
+  MappedFile file(filename);
+
+  GrowCacheHeader expected = GrowCacheHeader();
+  fillHeader(expected);
+
+  GrowCacheHeader header = GrowCacheHeader();
+  if (file.size() < padded(sizeof(header))) return false;
+  memcpy(&header, file.begin(), sizeof(header));
+
+  if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+      || header.version != expected.version
+      || header.byteorder != expected.byteorder
+      || memcmp(header.sizes, expected.sizes, sizeof(header.sizes)) != 0)
+    return false;
+
+  uint64_t const * c = header.counts;
+  size_t expectedsize = padded(sizeof(header))
+    + padded(c[ENTRIES] * sizeof(Entry)) + padded(c[SOURCES] * sizeof(WPoint))
+    + padded(c[POINTS] * sizeof(WPoint)) + padded(c[POINTS] * sizeof(int));
+  if (file.size() != expectedsize) return false;
+
+  char const * p = file.begin() + padded(sizeof(header));
+  p = readVector(p, entries, c[ENTRIES]);
+  p = readVector(p, sources, c[SOURCES]);
+  p = readVector(p, points, c[POINTS]);
+  p = readVector(p, offsets, c[POINTS]);
+
+  // entries that don't fit the arrays mean a damaged file
+  for(size_t i = 0; i < entries.size(); ++i)
+  {
+    Entry const & e = entries[i];
+    if ((uint64_t)e.source + e.vertices > c[SOURCES] || (uint64_t)e.grown + e.gvertices > c[POINTS])
+    {
+      clear();
+      return false;
+    }
+  }
+  rehash(entries.size());
+  return true;
+}
+
+void GrowCache::save(char const * filename) const
+{
+  GrowCacheHeader header = GrowCacheHeader();
+  fillHeader(header);
+  header.counts[ENTRIES] = entries.size();
+  header.counts[SOURCES] = sources.size();
+  header.counts[POINTS] = points.size();
+
+  CFile fp(filename, "wb");
+  writeSection(fp, &header, sizeof(header));
+  writeVector(fp, entries);
+  writeVector(fp, sources);
+  writeVector(fp, points);
+  writeVector(fp, offsets);
+  fp.close();
+}
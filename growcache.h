@@ -0,0 +1,91 @@
+#ifndef growcache_h
+#define growcache_h
+
+#include "world.h"
+
+/*! Grown obstacles from earlier runs, found by what they were grown from
+
+   Each entry holds one grown obstacle under a key that hashes the
+   obstacle's vertices together with the way it was grown: the method and
+   the robot corners after scaling by the multiplier, or the fgrowShapes
+   amount. Obstacles that didn't change since the last run find their
+   grown shape here no matter where they sit in the obstacle file, and
+   only new or edited ones are grown again. Entries also keep the
+   obstacle's vertices, so a hash collision counts as a miss rather than
+   returning somebody else's shape.
+
+   growShapes, growSlices and fgrowShapes use the cache set in
+   World::growCache and count hits and misses in it. Lookups from the
+   worker threads only read the cache. New entries are added afterwards,
+   on the calling thread.
+
+   save() writes every entry, including ones for obstacles that are gone.
+   Delete the file to start over.
+*/
+class GrowCache
+{
+public:
+  typedef World::coord coord;
+  typedef World::WPoint WPoint;
+  typedef World::Vertex Vertex;
+  typedef World::GVertex GVertex;
+
+  GrowCache();
+
+  //! obstacles found in and missing from the cache since it was made or counters were reset
+  long hits, misses;
+
+  //! hash of a grow method and its parameters, to start keys with
+  static uint64_t method(char const * name, void const * parameters, size_t size);
+
+  //! key of an obstacle grown with a method
+  static uint64_t key(uint64_t method, Vertex const * vertices, int n);
+
+  //! on a hit, append the grown obstacle to out with the given shape number,
+  //! and vertex numbers counted from startidx. const, so workers can share it
+  bool find(uint64_t key, Vertex const * vertices, int n, int shapeno, int startidx, vector<GVertex> & out) const;
+
+  //! add an obstacle grown into grown[0, ngrown), whose vertex numbers count from startidx
+  void insert(uint64_t key, Vertex const * vertices, int n, GVertex const * grown, int ngrown, int startidx);
+
+  size_t size() const
+  {
+    return entries.size();
+  }
+
+  void clear();
+
+  //! read a cache file written by save. returns false, leaving the cache empty, if there isn't a usable one
+  bool load(char const * filename);
+
+  void save(char const * filename) const;
+
+private:
+  struct Entry
+  {
+    uint64_t key;
+    uint32_t source;  //!< obstacle vertices are sources[source] on
+    uint32_t vertices;
+    uint32_t grown;   //!< grown vertices are points[grown] and offsets[grown] on
+    uint32_t gvertices;
+  };
+
+  vector<Entry> entries;
+  vector<WPoint> sources;
+  vector<WPoint> points;
+
+  //! vertex number of each grown vertex less the obstacle's first vertex number
+  vector<int> offsets;
+
+  //! open addressed table of entry numbers plus one, 0 for an empty slot.
+  //! keys are hashes already, so their low bits pick the first slot to try
+  vector<uint32_t> slots;
+
+  //! slot holding key, or the empty slot where it would go
+  size_t slot(uint64_t key) const;
+
+  //! rebuild slots with room for n entries
+  void rehash(size_t n);
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include "math.h"
 #include <vector>
 #include <algorithm>
+#include <iterator>
 #include <assert.h>
 
 #define PI 3.14159265358979323846264338328
@@ -114,9 +115,19 @@ struct Point
 template<typename T>
 bool inline linesIntersect(Point<T> P1, Point<T> Q1, Point<T> P2, Point<T> Q2);  
 
-//! Find the convex hull of a set of points. Could be more generic...
-template<typename T>
-void convexHull(vector<Point<T> > const & points, vector<Point<T> > & hull);
+//! Find the convex hull of a set of points, counterclockwise from the lowest, rightmost one.
+//! Returns the end of the hull. scratch is reused between calls so they don't allocate
+template<class InputIterator, class OutputIterator, class PointType>
+OutputIterator convexHull(InputIterator pointStart, InputIterator pointEnd, OutputIterator hullStart, vector<PointType> & scratch);
+
+//! convexHull with its own scratch space
+template<class InputIterator, class OutputIterator>
+OutputIterator convexHull(InputIterator pointStart, InputIterator pointEnd, OutputIterator hullStart);
+
+//! Convex counterclockwise polygons a and b, of at least three points, overlap, touch, or one holds the other.
+//! Separating axis test in O(na + nb)
+template<class PointType>
+bool convexOverlap(PointType const * a, size_t na, PointType const * b, size_t nb);
 
 /////////////////////////////////////////////////////////////////// DEFINITIONS
 
@@ -199,58 +210,48 @@ double Point<T>::distanceTo(Point<T> P, Point<T> Q) const
   return sqrt(dx*dx + dy*dy);
 }
 
-template<typename T>
-int Point<T>::line_side(Point<T> P, Point<T> Q) const
+// Type used for the cross products in the orientation tests. int and
+// short coordinates are widened to 64 bits, which is always exact. long
+// and long long coordinates are widened to 128 bits where the compiler
+// has them, and are exact then too. Without them they stay 64 bits, and
+// the tests are only exact while coordinate differences fit in 31 bits.
+// Floating point coordinates are not exact.
+
+template<typename T> struct _Point_wide { typedef T type; };
+template<> struct _Point_wide<int> { typedef long long type; };
+template<> struct _Point_wide<short> { typedef long long type; };
+#ifdef __SIZEOF_INT128__
+template<> struct _Point_wide<long> { typedef __int128 type; };
+template<> struct _Point_wide<long long> { typedef __int128 type; };
+#else
+template<> struct _Point_wide<long> { typedef long long type; };
+#endif
+template<> struct _Point_wide<float> { typedef double type; };
+
+//! cross product a x b, positive when b is counterclockwise of a. exact when the products fit W
+template<typename W>
+inline W _Point_cross(W ax, W ay, W bx, W by)
 {
-  if(P.y == Q.y) // horizontal
-    if(this->y < P.y)
-      return RIGHT_SIDE;
-    else if(this->y > P.y)
-      return LEFT_SIDE;
-    else
-      return (this->x == P.x ) ? LEFT_SIDE | RIGHT_SIDE : 0;
-  
-  // x coordinate of the point on the line where y = this->y
-  T x = P.x == Q.x ? P.x : P.x + (Q.x-P.x) * (this->y-P.y) / (Q.y-P.y);
-  if(this->x < x)
-    return LEFT_SIDE;
-  else if(this->x > x)
-    return RIGHT_SIDE;
-  else
-    return LEFT_SIDE | RIGHT_SIDE;
+  return ax * by - ay * bx;
 }
 
+// Points closer to the origin than this on both axes have differences,
+// and cross products of differences, that are exact in a double too.
+// The AVX2 edge kernel and the rotational sweep only run on those.
+
+const double _Point_EXACT_LIMIT = 1 << 24;
+
 template<typename T>
-int Point<T>::line_rside(Point<T> P, Point<T> Q) const
+bool _Point_small(Point<T> const & p)
 {
+  return p.x > -_Point_EXACT_LIMIT && p.x < _Point_EXACT_LIMIT && p.y > -_Point_EXACT_LIMIT && p.y < _Point_EXACT_LIMIT;
+}
 
-/* this is sedgewick's nicer ccw algorithm, 
-  but it doesn't seem to work for certain cases
-  like P.x == Q.x == this->x
- 
-  T dx1 = Q.x-P.x;
-  T dy1 = Q.y-P.y; 
-  T dx2 = this->x - P.x;
-  T dy2 = this->y - P.y; 
-  T x1y2 = dx1 * dy2;
-  T x2y1 = dy1 * dx2;
-  
-  if (x1y2 > x2y1)
-    return LEFT_SIDE;
-  else if (x1y2 < x2y1)
-    return RIGHT_SIDE; 
-  else
-  {
-    if (dx1*dx2<0 || dy1*dy2<0)
-      return RIGHT_SIDE;
-    else if (dx1*dx1+dy1*dy1 >= dx2*dx2+dy2*dy2)
-      return LEFT_SIDE | RIGHT_SIDE;
-    else 
-      return LEFT_SIDE;
-  }
- */
-
-  int r = line_side(P,Q);
+template<typename T>
+int Point<T>::line_side(Point<T> P, Point<T> Q) const
+{
+  // line_rside without the direction flip
+  int r = line_rside(P,Q);
   if (P.y > Q.y || (P.y == Q.y && P.x > Q.x))
   {
     if (r == LEFT_SIDE)
@@ -259,6 +260,31 @@ int Point<T>::line_rside(Point<T> P, Point<T> Q) const
       return LEFT_SIDE;
   }
   return r;
+}
+
+template<typename T>
+int Point<T>::line_rside(Point<T> P, Point<T> Q) const
+{
+  // Sign of the cross product (Q - P) x (this - P), computed in a wider
+  // type so there is no division and no rounding.
+  typedef typename _Point_wide<T>::type W;
+  W dx = (W)Q.x - (W)P.x;
+  W dy = (W)Q.y - (W)P.y;
+  W rx = (W)this->x - (W)P.x;
+  W ry = (W)this->y - (W)P.y;
+  W cross = _Point_cross(dx, dy, rx, ry);
+  
+  int r = (cross > 0) | ((cross < 0) << 1); // LEFT_SIDE or RIGHT_SIDE
+  if (r) return r;
+  
+  // Collinear. These cases keep the results of the original test, which
+  // measured the side along a horizontal line through this point.
+  if (dy != 0)
+    return LEFT_SIDE | RIGHT_SIDE;
+  else if (dx != 0 || ry == 0) // on a horizontal line, only P itself counts as on it
+    return rx == 0 ? LEFT_SIDE | RIGHT_SIDE : 0;
+  else // P and Q coincide
+    return ry > 0 ? LEFT_SIDE : RIGHT_SIDE;
 } 
 
 template<typename T>
@@ -267,48 +293,27 @@ bool linesIntersect(Point<T> P1, Point<T> Q1, Point<T> P2, Point<T> Q2)
   return !(P2.line_rside(P1, Q1) & Q2.line_rside(P1, Q1) || P1.line_rside(P2, Q2) & Q1.line_rside(P2, Q2));
 }
 
-// This class is only used inside the convexHull function, but for some reason
-// metrowerks won't allow me to instantiate it there if it is declared inside.
+// Cross product (A - O) x (B - O) in the wide type, positive when O, A, B
+// turn counterclockwise. Only used by convexHull, outside because of G++.
 
-template<class T>
-struct _convexHull_cpoint
+template<typename T>
+typename _Point_wide<T>::type _convexHull_turn(Point<T> const & O, Point<T> const & A, Point<T> const & B)
 {
-  T point;
-  double angle;
-  
-  _convexHull_cpoint() {}
-  
-  _convexHull_cpoint(T point_, double angle_)
-  : point(point_), angle(angle_) { }
-};
-
+  typedef typename _Point_wide<T>::type W;
+  return _Point_cross((W)A.x - O.x, (W)A.y - O.y, (W)B.x - O.x, (W)B.y - O.y);
+}
 
- // outside because of G++
-template<class InputIterator>
-class _convexHull_cpointLessThan
+template<class PointType>
+struct _convexHull_xyLess
 {
-  typedef _convexHull_cpoint<InputIterator> cpoint;
-public:
-
-  bool operator()(cpoint a, cpoint b)
+  bool operator()(PointType const & a, PointType const & b) const
   {
-    if (a.angle != b.angle)
-      return a.angle < b.angle;
-    else
-    {
-      bool acloser = a.point->distanceTo(*pivot) < b.point->distanceTo(*pivot);
-      return (a.angle <= PI / 2.0) ? acloser : !acloser;
-    }  
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
   }
-  
-  _convexHull_cpointLessThan(InputIterator pivot_)
-  : pivot(pivot_) { } 
-  
-  InputIterator pivot;
 };
 
-template<class InputIterator, class OutputIterator>
-OutputIterator convexHull(InputIterator pointStart, InputIterator pointEnd, OutputIterator hullStart)
+template<class InputIterator, class OutputIterator, class PointType>
+OutputIterator convexHull(InputIterator pointStart, InputIterator pointEnd, OutputIterator hullStart, vector<PointType> & scratch)
 {
 
   // orientation:
@@ -319,78 +324,59 @@ OutputIterator convexHull(InputIterator pointStart, InputIterator pointEnd, Outp
   //          |
   //          |
   //       -y v
-  
-  typedef _convexHull_cpoint<InputIterator> cpoint;
-  typedef _convexHull_cpointLessThan<InputIterator> cpointLessThan;
-  
-  assert(pointEnd - pointStart >= 3); // need at least 3 points
-  
-  // pivot will be the lowest, rightmost point
-  InputIterator pivot = pointStart;
-  for(InputIterator i = pointStart + 1; i != pointEnd; ++i)
+
+  // Andrew's monotone chain. The points are sorted by x and then y at the
+  // front of scratch, and the lower and upper chains are built as a stack
+  // behind them. Points that don't make a strict left turn are popped, so
+  // collinear points are left out.
+
+  size_t n = pointEnd - pointStart;
+  assert(n >= 3); // need at least 3 points
+
+  scratch.assign(pointStart, pointEnd);
+  sort(scratch.begin(), scratch.end(), _convexHull_xyLess<PointType>());
+  scratch.resize(3 * n);
+
+  size_t h = n; // top of the stack
+  for(size_t i = 0; i < n; ++i) // lower chain, left to right
   {
-    if (i->y < pivot->y || (i->y == pivot->y && i->x > pivot->x))
-      pivot = i;
+    while (h >= n + 2 && _convexHull_turn(scratch[h-2], scratch[h-1], scratch[i]) <= 0)
+      --h;
+    scratch[h++] = scratch[i];
   }
-  
-  vector<cpoint> cpoints; // not really efficient if the function is called repeatedly
-  typedef vector<cpoint>::const_iterator icpoint;
-  
-  cpoints.push_back(cpoint(pivot,0));
-  
-  for(InputIterator i = pointStart; i != pointEnd; ++i)
-  {
-    if (!i->equals(*pivot)) // can't find the angle between a point and itself
-    {
-      double a = atan2(i->y - pivot->y, i->x - pivot->x);
-      // sanity check, angle from the pivot must be between 0 and PI since pivot is the lowest point
-      assert(a >= 0 && a <= PI); 
-      cpoints.push_back(cpoint(i,a));
-    }  
-  };
-
-  sort(cpoints.begin() + 1, cpoints.end(), cpointLessThan(pivot));
-
-  //for (icpoint p = cpoints.begin(); p !=  cpoints.end(); ++p)
-  //  cerr << (p - cpoints.begin())<< '\t' << p->point->x << '\t' << p->point->y << '\t' << p->angle<< endl;
- 
-  OutputIterator hull = hullStart;
-  int i = 0;
-  int hlkjh = cpoints.end() - cpoints.begin();  
-  while(i < 2) // add first two points
+
+  size_t lower = h + 1;
+  for(size_t i = n - 1; i-- > 0; ) // upper chain, right to left
   {
-    *hull = *cpoints[i].point;
-    ++hull; ++i;
+    while (h >= lower && _convexHull_turn(scratch[h-2], scratch[h-1], scratch[i]) <= 0)
+      --h;
+    scratch[h++] = scratch[i];
   }
+  --h; // the upper chain ends on the first point again
 
-  typedef vector<cpoint>::const_iterator icpoints;
-  while(i < cpoints.size())
-  {
-    
-    OutputIterator _hp = hull - 1;
-    OutputIterator _hpp = hull - hullStart > 1 ? hull -2 : hull - 1;
-    
-    
-    assert(hull - hullStart > 0); // hull must have at least one point
-    if (hull - hullStart ==  1 || cpoints[i].point->line_rside(*(hull-2), *(hull-1))  == Point<int>::LEFT_SIDE)
-    {
+  // start from the lowest, rightmost point like the graham scan used to
+  size_t pivot = n;
+  for(size_t i = n + 1; i < h; ++i)
+    if (scratch[i].y < scratch[pivot].y || (scratch[i].y == scratch[pivot].y && scratch[i].x > scratch[pivot].x))
+      pivot = i;
 
-      assert(hull >= hullStart && hull - hullStart < cpoints.size());
-      *hull = *cpoints[i].point;
-      ++hull; ++i;
-    }
-    else
-      --hull;
-  };
-  
-  assert(hull - hullStart >= 2);
-  
-  if (hull - hullStart > 2 &&  hullStart->line_rside(*(hull-2), *(hull-1))  != Point<int>::LEFT_SIDE)
-    --hull;
+  OutputIterator hull = hullStart;
+  for(size_t i = pivot; i < h; ++i, ++hull)
+    *hull = scratch[i];
+  for(size_t i = n; i < pivot; ++i, ++hull)
+    *hull = scratch[i];
 
+  assert(hull - hullStart >= 2);
   return hull;
 }
 
+template<class InputIterator, class OutputIterator>
+OutputIterator convexHull(InputIterator pointStart, InputIterator pointEnd, OutputIterator hullStart)
+{
+  vector<typename std::iterator_traits<InputIterator>::value_type> scratch;
+  return convexHull(pointStart, pointEnd, hullStart, scratch);
+}
+
 /* for each polygon vertex, based on the angle of
    previous and next vertices
    remove vertices for which the angle has measure 180 degrees
@@ -477,4 +463,41 @@ bool orient_poly(RandomAccessIterator pointStart, RandomAccessIterator pointEnd)
   return true;
 }
 
+// True if some edge of a has all of b strictly on its right, so the edge's
+// line separates them. As the edges of a turn counterclockwise, the point
+// of b furthest to their left moves counterclockwise around b, so a single
+// walk around b finds it for every edge.
+
+template<class PointType>
+bool _convexOverlap_separates(PointType const * a, size_t na, PointType const * b, size_t nb)
+{
+  size_t j = 0; // point of b furthest left of the first edge
+  for(size_t k = 1; k < nb; ++k)
+    if (_convexHull_turn(a[0], a[1], b[k]) > _convexHull_turn(a[0], a[1], b[j]))
+      j = k;
+
+  for(size_t i = 0; i < na; ++i)
+  {
+    PointType const & P = a[i];
+    PointType const & Q = a[(i + 1) % na];
+    for(size_t step = 0; step < nb; ++step)
+    {
+      size_t next = j + 1 == nb ? 0 : j + 1;
+      if (_convexHull_turn(P, Q, b[next]) <= _convexHull_turn(P, Q, b[j]))
+        break;
+      j = next;
+    }
+    if (_convexHull_turn(P, Q, b[j]) < 0)
+      return true;
+  }
+  return false;
+}
+
+template<class PointType>
+bool convexOverlap(PointType const * a, size_t na, PointType const * b, size_t nb)
+{
+  assert(na >= 3 && nb >= 3);
+  return !_convexOverlap_separates(a, na, b, nb) && !_convexOverlap_separates(b, nb, a, na);
+}
+
 #endif
@@ -16,6 +16,8 @@
 #include "world.h"
 #include "general.h"
 #include "point.h"
+#include "workerpool.h"
+#include "growcache.h"
 
 typedef void follower(void);
 typedef Point<float> RPoint;
@@ -23,6 +25,7 @@ typedef Point<float> RPoint;
 ////////////////////////////////////////////////////////////// global variables
 
 World world;
+WorkerPool workers;
 Point<float> initialPosition(4235, 475);
 World::PathIterator current(world);
 World::PathIterator last(world);
@@ -57,35 +60,68 @@ int WINAPI WinMain( HINSTANCE hInst, HINSTANCE hPreInst, LPSTR lpszCmdLine, int
 {
   try
   { 
-    CFile obstacle(INPATH "obstacle.txt", "r");
-    world.readFile(obstacle,world.vertices,&world.shapes);
+    world.workers = &workers;
+    world.readFile(INPATH "obstacle.txt",world.vertices,&world.shapes);
 
-    CFile start(INPATH "start.txt","r");
-    world.readFile(start,world.startarea);
+    // or read the obstacles straight from a saphira world file
+    //world.readWorldFile(INPATH "CEPSR_hw.wld");
 
-    CFile goal(INPATH "goal.txt","r");
-    world.readFile(goal,world.goalarea);
+    world.readFile(INPATH "start.txt",world.startarea);
+    world.readFile(INPATH "goal.txt",world.goalarea);
 
 
+    // MARGIN SWEEP: to tune the multiplier, uncomment these lines to plan
+    // for multipliers 1.0 through 2.0 at once and write the path length,
+    // graph size and build time for each to margins.txt. The largest
+    // multiplier that still finds a path is the safest one for this map.
+    // Pass true and a range of diameters to sweep fgrowShapes instead.
+
+    //vector<World::MarginResult> margins;
+    //world.sweepMargins(1.0, 2.0, 11, false, margins);
+    //CFile marginfile(OUTPATH "margins.txt", "w");
+    //World::outputMargins(marginfile, margins);
+
     // GROW METHOD #1:
-    world.growShapes(1.6);
-    
-    
+    World::GrowParameters growth(World::GrowParameters::GROW_SHAPES, 1.6);
+
     // GROW METHOD #2 (fast)
-    // the second argument is the diameter of the robot
+    // the amount is the diameter of the robot
     // calculated from "370 x 550  mm."
     // current value is too conservative for our obstacle course
- 
-    //world.fgrowShapes(662.87253676706202790366913417296);    
+
+    //World::GrowParameters growth(World::GrowParameters::FGROW_SHAPES, 662.87253676706202790366913417296);
+
+    // or growSlices for 8 headings, see world.cpp
+    //World::GrowParameters growth(World::GrowParameters::GROW_SLICES, 1.0, 8);
+
+    // The grown shapes, visibility graph and path are saved in a snapshot
+    // and reused on the next run as long as the input files and the grow
+    // method don't change.
+    uint64_t hash = world.inputHash(growth);
+
+    if (!world.loadSnapshot(OUTPATH "world.snap", hash))
+    {
+      // obstacles that haven't changed since an earlier run are taken
+      // from the grow cache instead of being grown again
+      GrowCache growCache;
+      growCache.load(OUTPATH "grow.cache");
+      world.growCache = &growCache;
+
+      world.grow(growth);
+
+      world.growCache = NULL;
+      growCache.save(OUTPATH "grow.cache");
+
+      world.makeVisibility();
+      world.findPath();
+      world.saveSnapshot(OUTPATH "world.snap", hash);
+    }
   
     CFile grown(OUTPATH "grown.txt","w");
     world.outputShapes(grown, world.vertices.begin(), world.vertices.end());
     world.outputShapes(grown, world.gvertices.begin(), world.gvertices.end());
 
-    world.makeVisibility();
     CFile visibility(OUTPATH "visibility.txt","w");
-
-    world.findPath();
  
     CFile thepath(OUTPATH "path.txt","w");
     world.outputPath(thepath);
@@ -0,0 +1,554 @@
+#include "rotsweep.h"
+
+#include <algorithm>
+#include <math.h>
+
+/*
+
+Rotational sweep
+
+from(p) puts every grown vertex other than the ones at P = nodes[p] in
+counterclockwise order around P, starting from +x, and turns a ray
+through them. Each edge that isn't on a line through P is oriented so
+that it goes counterclockwise from its end a to its end b as seen from
+P, and it is in the tree while the ray is strictly between a and b.
+Edges that wrap past +x start out in the tree. Along ray direction D,
+edge e crosses at
+
+  r = num / d,  num = (a - P) x (b - P) > 0,  d = D x (b - a) > 0
+
+times D, so the tree orders edges by num_e * d_f < num_f * d_e in 128
+bits. Edges tied on the ray are ordered by where they go next, so an
+edge inserted at a vertex lands where it will be a moment later.
+
+The vertices are sorted by a pseudo angle in doubles first, and an
+insertion sort by exact cross products then fixes the few neighbours
+that rounding put in the wrong order. Vertices in the same direction
+from P are handled as one stop: edges ending there leave the tree,
+nodes q < p there get their answer, then edges starting there join.
+Node q at Q is blocked if an edge on a line through P, or an edge with
+an end at this stop, intersects PQ by the same linesIntersect test
+EdgeTable::intersects uses. The edges in the
+tree all cross the ray strictly between their ends, so they block PQ
+when they cross the ray before Q. The walk from the nearest edge stops
+at the first one crossing beyond Q, and only an edge passing through Q
+itself goes to linesIntersect. Nodes at P test pairs.
+
+Grown obstacles may overlap, and two edges that cross change places in
+the tree. assign collects every pair of edges that cross away from their
+ends as an exact rational point, and from(p) swaps the pair when the
+ray reaches it. Where more edges cross at one point, the whole run of
+them is put in order. Crossings are put between the right stops
+exactly, and in order between stops by angle, which is only checked
+exactly where it matters, for crossings on the same edge. If a crossing
+has no exact place, or its edges aren't next to each other in the tree,
+the whole row is tested in pairs instead and counted in fallbacks.
+
+The sweep costs O((n + c) log n) for n vertices and c crossings, so all
+rows take O(n^2 log n) instead of O(n^3) edge tests.
+
+*/
+
+namespace
+{
+  typedef _Point_wide<World::coord>::type wide;
+
+  //! 0 for angles in [0, PI) from +x, 1 for [PI, 2 PI)
+  template<typename T>
+  int half(T x, T y)
+  {
+    return y < 0 || (y == 0 && x < 0);
+  }
+
+  //! counterclockwise angle from +x of (ax, ay) is less than that of (bx, by). the
+  //! products are taken in T, which callers pick wide enough
+  template<typename T>
+  bool angleLess(T ax, T ay, T bx, T by)
+  {
+    int ha = half(ax, ay), hb = half(bx, by);
+    return ha != hb ? ha < hb : ax * by - ay * bx > 0;
+  }
+
+  //! increases with the counterclockwise angle from +x, in [0, 4). cheaper than atan2, and
+  //! only used to sort roughly before the exact order
+  double pseudoAngle(double x, double y)
+  {
+    double r = y / (fabs(x) + fabs(y));
+    return x >= 0 ? (y >= 0 ? r : 4 + r) : 2 - r;
+  }
+
+  //! shape turns left at every vertex and goes around once, so its edges can't cross each other
+  bool simple(vector<World::GVertex> const & v, World::Shape const & s)
+  {
+    int nv = s.vertices;
+    if (nv <= 3)
+      return true;
+    int windings = 0;
+    for(int i = 0; i < nv; ++i)
+    {
+      World::WPoint A = v[s.startidx + i], B = v[s.startidx + (i + 1) % nv], C = v[s.startidx + (i + 2) % nv];
+      if (_Point_cross<wide>(B.x - A.x, B.y - A.y, C.x - B.x, C.y - B.y) <= 0)
+        return false;
+      windings += B.y - A.y < 0 && C.y - B.y >= 0;
+    }
+    return windings == 1;
+  }
+}
+
+RotationalSweep::RotationalSweep()
+: fallbacks(0), gvertices(NULL), nodes(NULL), edges(NULL), status(Nearer{this})
+{
+}
+
+// only what assign loaded, from() sets up everything else
+RotationalSweep::RotationalSweep(RotationalSweep const & other)
+: fallbacks(0), gvertices(other.gvertices), nodes(other.nodes), edges(other.edges),
+  next(other.next), prev(other.prev), nodeOf(other.nodeOf), crossings(other.crossings), status(Nearer{this})
+{
+}
+
+bool RotationalSweep::assign(World const & world, NodeTable const & nodes_, EdgeTable const & edges_)
+{
+  gvertices = world.gvertices.empty() ? NULL : &world.gvertices[0];
+  nodes = &nodes_;
+  edges = &edges_;
+
+#ifndef __SIZEOF_INT128__
+  return false;
+#endif
+
+  int nv = world.gvertices.size();
+  for(int v = 0; v < nv; ++v)
+    if (!_Point_small(gvertices[v]))
+      return false;
+  for(size_t q = 0; q < nodes->size(); ++q)
+    if (!_Point_small((*nodes)[q]))
+      return false;
+
+  next.assign(nv, -1);
+  prev.assign(nv, -1);
+  for(size_t s = 0; s < world.gshapes.size(); ++s)
+  {
+    World::Shape const & shape = world.gshapes[s];
+    for(int i = 0; i < shape.vertices; ++i)
+    {
+      int v = shape.startidx + i, w = shape.startidx + (i + 1) % shape.vertices;
+      next[v] = w;
+      prev[w] = v;
+    }
+  }
+  for(int v = 0; v < nv; ++v)
+    if (next[v] < 0)
+      return false; // a vertex outside every shape, which EdgeTable wouldn't have an edge for
+
+  nodeOf.assign(nv, -1);
+  for(size_t q = 0; q < world.nodes.size(); ++q)
+    if (world.nodes[q] >= 0)
+      nodeOf[world.nodes[q]] = q;
+
+  // shapes whose bounding boxes overlap, by a sweep over their left sides
+  int ns = world.gshapes.size();
+  vector<coord> xmin(ns), xmax(ns), ymin(ns), ymax(ns);
+  vector<int> byx(ns);
+  for(int s = 0; s < ns; ++s)
+  {
+    World::Shape const & shape = world.gshapes[s];
+    byx[s] = s;
+    xmin[s] = ymin[s] = _Point_EXACT_LIMIT;
+    xmax[s] = ymax[s] = -_Point_EXACT_LIMIT;
+    for(int i = 0; i < shape.vertices; ++i)
+    {
+      WPoint V = gvertices[shape.startidx + i];
+      xmin[s] = std::min(xmin[s], V.x); xmax[s] = std::max(xmax[s], V.x);
+      ymin[s] = std::min(ymin[s], V.y); ymax[s] = std::max(ymax[s], V.y);
+    }
+  }
+  std::sort(byx.begin(), byx.end(), [&](int s, int t) { return xmin[s] < xmin[t]; });
+
+  crossings.resize(0);
+  for(int i = 0; i < ns; ++i)
+  {
+    int s = byx[i];
+    for(int j = simple(world.gvertices, world.gshapes[s]) ? i + 1 : i; j < ns && xmin[byx[j]] <= xmax[s]; ++j)
+    {
+      int t = byx[j];
+      if (ymin[t] > ymax[s] || ymin[s] > ymax[t])
+        continue;
+
+      World::Shape const & S = world.gshapes[s];
+      World::Shape const & T = world.gshapes[t];
+      for(int e = S.startidx; e < S.startidx + S.vertices; ++e)
+      for(int f = T.startidx; f < T.startidx + T.vertices; ++f)
+      {
+        if (s == t && f <= e)
+          continue;
+        WPoint A1 = gvertices[e], B1 = gvertices[next[e]];
+        WPoint A2 = gvertices[f], B2 = gvertices[next[f]];
+        wide d1x = B1.x - A1.x, d1y = B1.y - A1.y;
+        wide d2x = B2.x - A2.x, d2y = B2.y - A2.y;
+        wide c1 = _Point_cross<wide>(d1x, d1y, (wide)A2.x - A1.x, (wide)A2.y - A1.y);
+        wide c2 = _Point_cross<wide>(d1x, d1y, (wide)B2.x - A1.x, (wide)B2.y - A1.y);
+        wide c3 = _Point_cross<wide>(d2x, d2y, (wide)A1.x - A2.x, (wide)A1.y - A2.y);
+        wide c4 = _Point_cross<wide>(d2x, d2y, (wide)B1.x - A2.x, (wide)B1.y - A2.y);
+        if (!((c1 < 0 && c2 > 0) || (c1 > 0 && c2 < 0)) || !((c3 < 0 && c4 > 0) || (c3 > 0 && c4 < 0)))
+          continue;
+
+        Crossing c;
+        c.e1 = e;
+        c.e2 = f;
+        c.n = c3 - c4 > 0 ? c3 : -c3;
+        c.d = c3 - c4 > 0 ? c3 - c4 : c4 - c3;
+        crossings.push_back(c);
+      }
+    }
+  }
+  return true;
+}
+
+bool RotationalSweep::nearer(int e, int f) const
+{
+  wide uex = ux[e], uey = uy[e];
+  wide ufx = ux[f], ufy = uy[f];
+  huge le = (huge)num[e] * _Point_cross<wide>(dx, dy, ufx, ufy);
+  huge lf = (huge)num[f] * _Point_cross<wide>(dx, dy, uex, uey);
+  if (le != lf)
+    return le < lf;
+
+  // crossing the ray at the same point, so the nearer one a moment later
+  wide turn = _Point_cross<wide>(ufx, ufy, uex, uey);
+  if (turn != 0)
+    return turn > 0;
+  return e < f;
+}
+
+bool RotationalSweep::blocked(WPoint Q) const
+{
+  for(size_t i = 0; i < through.size(); ++i)
+    if (linesIntersect(P, Q, point(through[i]), point(next[through[i]])))
+      return true;
+  for(size_t i = 0; i < touching.size(); ++i)
+    if (linesIntersect(P, Q, point(touching[i]), point(next[touching[i]])))
+      return true;
+
+  wide qx = (wide)Q.x - P.x, qy = (wide)Q.y - P.y;
+  for(Status::const_iterator i = status.begin(); i != status.end(); ++i)
+  {
+    int e = edgeAt[*i];
+    wide d = _Point_cross<wide>(qx, qy, ux[e], uy[e]);
+    if (num[e] > d)
+      return false; // this and every later edge cross the ray beyond Q
+    if (num[e] < d)
+      return true;
+    if (linesIntersect(P, Q, point(e), point(next[e])))
+      return true;
+  }
+  return false;
+}
+
+void RotationalSweep::insert(int e)
+{
+  int s;
+  if (freeSlots.empty())
+  {
+    s = edgeAt.size();
+    edgeAt.push_back(e);
+    where.push_back(status.end());
+  }
+  else
+  {
+    s = freeSlots.back();
+    freeSlots.pop_back();
+    edgeAt[s] = e;
+  }
+  slotOf[e] = s;
+  where[s] = status.insert(s).first;
+}
+
+void RotationalSweep::erase(int e)
+{
+  int s = slotOf[e];
+  status.erase(where[s]);
+  freeSlots.push_back(s);
+  slotOf[e] = -1;
+}
+
+bool RotationalSweep::meets(int g, Crossing const & c) const
+{
+  WPoint A = point(c.e1), B = point(next[c.e1]), G = point(g), H = point(next[g]);
+  huge x = (huge)((wide)A.x - G.x) * c.d + (huge)((wide)B.x - A.x) * c.n;
+  huge y = (huge)((wide)A.y - G.y) * c.d + (huge)((wide)B.y - A.y) * c.n;
+  return (huge)((wide)H.x - G.x) * y - (huge)((wide)H.y - G.y) * x == 0;
+}
+
+bool RotationalSweep::swap(Crossing const & c)
+{
+  int e1 = c.e1, e2 = c.e2;
+  if (!num[e1] || !num[e2])
+    return true; // on a line through P, not in the tree
+  if (slotOf[e1] < 0 || slotOf[e2] < 0)
+    return false;
+
+  // e1 and e2 are next to each other, unless more edges cross at the same point.
+  // then they are all in between
+  Status::iterator i1 = where[slotOf[e1]], i2 = where[slotOf[e2]];
+  Status::iterator begin = i1, end = i1;
+  while (++end != status.end() && end != i2 && meets(edgeAt[*end], c))
+    ;
+  if (end == i2)
+    ++end;
+  else
+  {
+    end = i1;
+    ++end;
+    while (begin != i2)
+    {
+      if (begin == status.begin())
+        return false;
+      --begin;
+      if (begin != i2 && !meets(edgeAt[*begin], c))
+        return false;
+    }
+  }
+
+  // the order a moment after the crossing
+  block.resize(0);
+  for(Status::iterator i = begin; i != end; ++i)
+    block.push_back(edgeAt[*i]);
+  std::sort(block.begin(), block.end(), [this](int e, int f)
+  {
+    wide turn = _Point_cross<wide>(ux[f], uy[f], ux[e], uy[e]);
+    return turn != 0 ? turn > 0 : e < f;
+  });
+  size_t k = 0;
+  for(Status::iterator i = begin; i != end; ++i, ++k)
+  {
+    edgeAt[*i] = block[k];
+    slotOf[block[k]] = *i;
+  }
+  return true;
+}
+
+bool RotationalSweep::before(int v, int w) const
+{
+  return angleLess<wide>(rx[v], ry[v], rx[w], ry[w]);
+}
+
+void RotationalSweep::from(int p, vector<char> & visible)
+{
+  NodeTable const & table = *nodes;
+  P = table[p];
+  visible.assign(p, 1);
+
+  // nodes at P itself have no direction
+  for(int q = 0; q < p; ++q)
+    if (table[q].equals(P))
+      visible[q] = !edges->intersects(P, table[q]);
+
+  int nv = next.size();
+  rx.resize(nv + 1);
+  ry.resize(nv + 1);
+  for(int v = 0; v <= nv; ++v)
+  {
+    WPoint V = point(v);
+    rx[v] = V.x - P.x;
+    ry[v] = V.y - P.y;
+  }
+
+  a.resize(nv);
+  b.resize(nv);
+  num.resize(nv);
+  ux.resize(nv);
+  uy.resize(nv);
+  through.resize(0);
+  for(int e = 0; e < nv; ++e)
+  {
+    int f = next[e];
+    wide n = _Point_cross<wide>(rx[e], ry[e], rx[f], ry[f]);
+    a[e] = n >= 0 ? e : f;
+    b[e] = n >= 0 ? f : e;
+    num[e] = n >= 0 ? n : -n;
+    ux[e] = (wide)rx[b[e]] - rx[a[e]];
+    uy[e] = (wide)ry[b[e]] - ry[a[e]];
+    if (!n)
+      through.push_back(e);
+  }
+
+  // sort by pseudo angle, then put neighbours the doubles got wrong in exact order
+  keyed.resize(0);
+  for(int v = 0; v <= nv; ++v)
+    if ((v < nv || p > 0) && (rx[v] || ry[v]))
+      keyed.push_back(std::make_pair(pseudoAngle(rx[v], ry[v]), v));
+  std::sort(keyed.begin(), keyed.end());
+  events.resize(keyed.size());
+  for(size_t i = 0; i < keyed.size(); ++i)
+  {
+    size_t j = i;
+    for(; j > 0 && before(keyed[i].second, events[j - 1]); --j)
+      events[j] = events[j - 1];
+    events[j] = keyed[i].second;
+  }
+
+  stops.resize(0);
+  for(size_t i = 0; i < events.size(); ++i)
+    if (i == 0 || before(events[i - 1], events[i]))
+      stops.push_back(i);
+
+  // the stop each crossing comes at or before, twice over plus one for crossings exactly at the stop
+  int nc = crossings.size();
+  cx.resize(nc);
+  cy.resize(nc);
+  angles.resize(nc);
+  place.resize(nc);
+  order.resize(0);
+  bool degraded = false;
+  for(int i = 0; i < nc; ++i)
+  {
+    Crossing const & c = crossings[i];
+    if (!num[c.e1] || !num[c.e2])
+      continue;
+    WPoint A = point(c.e1), B = point(next[c.e1]);
+    cx[i] = (huge)((wide)A.x - P.x) * c.d + (huge)((wide)B.x - A.x) * c.n;
+    cy[i] = (huge)((wide)A.y - P.y) * c.d + (huge)((wide)B.y - A.y) * c.n;
+
+    int lo = 0, hi = stops.size();
+    while (lo < hi)
+    {
+      int mid = (lo + hi) / 2;
+      int v = events[stops[mid]];
+      if (angleLess<huge>(rx[v], ry[v], cx[i], cy[i]))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == (int)stops.size())
+      continue; // after the last stop, nothing left to answer
+    int v = events[stops[lo]];
+    bool at = !angleLess<huge>(cx[i], cy[i], rx[v], ry[v]);
+    place[i] = 2 * lo + at;
+
+    double angle = atan2((double)cy[i], (double)cx[i]);
+    angles[i] = angle < 0 ? angle + 2 * PI : angle;
+    order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&](int i, int j)
+  {
+    return place[i] != place[j] ? place[i] < place[j] : angles[i] < angles[j];
+  });
+
+  // the angles may be off in the last bits. crossings on the same edge are the ones whose order
+  // matters, and they come in order along it. crossings at the same point can come in any order
+  for(size_t i = 0; i < order.size() && !degraded; ++i)
+  for(size_t j = i + 1; j < order.size() && place[order[j]] == place[order[i]] && angles[order[j]] - angles[order[i]] < 1e-9; ++j)
+  {
+    Crossing const & c1 = crossings[order[i]];
+    Crossing const & c2 = crossings[order[j]];
+    int e = c1.e1 == c2.e1 || c1.e1 == c2.e2 ? c1.e1 : c1.e2 == c2.e1 || c1.e2 == c2.e2 ? c1.e2 : -1;
+    if (e < 0)
+      continue;
+
+    // where each crosses e, along it from a[e] to b[e]
+    WPoint A = point(e), B = point(next[e]);
+    wide t[2][2];
+    for(int k = 0; k < 2; ++k)
+    {
+      Crossing const & c = k ? c2 : c1;
+      if (c.e1 == e)
+      {
+        t[k][0] = c.n;
+        t[k][1] = c.d;
+      }
+      else
+      {
+        WPoint C = point(c.e1), D = point(next[c.e1]);
+        wide c3 = _Point_cross<wide>((wide)D.x - C.x, (wide)D.y - C.y, (wide)A.x - C.x, (wide)A.y - C.y);
+        wide c4 = _Point_cross<wide>((wide)D.x - C.x, (wide)D.y - C.y, (wide)B.x - C.x, (wide)B.y - C.y);
+        t[k][0] = c3 - c4 > 0 ? c3 : -c3;
+        t[k][1] = c3 - c4 > 0 ? c3 - c4 : c4 - c3;
+      }
+    }
+    huge first = (huge)t[0][0] * t[1][1], second = (huge)t[1][0] * t[0][1];
+    if (a[e] != e)
+      std::swap(first, second);
+    if (first > second)
+      degraded = true;
+  }
+
+  // start with the edges the ray along +x crosses, ordered just above it
+  status.clear();
+  edgeAt.resize(0);
+  where.resize(0);
+  freeSlots.resize(0);
+  slotOf.assign(nv, -1);
+  dx = 1;
+  dy = 0;
+  for(int e = 0; e < nv && !degraded; ++e)
+  {
+    if (num[e] && before(b[e], a[e]))
+      insert(e);
+  }
+
+  size_t c = 0;
+  for(size_t s = 0; s < stops.size() && !degraded; ++s)
+  {
+    size_t begin = stops[s], end = s + 1 < stops.size() ? stops[s + 1] : events.size();
+
+    while (c < order.size() && place[order[c]] <= 2 * (int)s)
+      if (!swap(crossings[order[c++]]))
+        degraded = true;
+
+    dx = rx[events[begin]];
+    dy = ry[events[begin]];
+
+    touching.resize(0);
+    for(size_t i = begin; i < end; ++i)
+    {
+      int v = events[i];
+      if (v == nv)
+        continue;
+      int ends[2] = { prev[v], v };
+      for(int k = 0; k < 2; ++k)
+      {
+        int e = ends[k];
+        if (!num[e])
+          continue;
+        touching.push_back(e);
+        if (b[e] == v && slotOf[e] >= 0)
+          erase(e);
+      }
+    }
+
+    while (c < order.size() && place[order[c]] <= 2 * (int)s + 1)
+      if (!swap(crossings[order[c++]]))
+        degraded = true;
+    if (degraded)
+      break;
+
+    for(size_t i = begin; i < end; ++i)
+    {
+      int q = events[i] == nv ? 0 : nodeOf[events[i]];
+      if (q >= 0 && q < p)
+        visible[q] = !blocked(point(events[i]));
+    }
+
+    for(size_t i = begin; i < end; ++i)
+    {
+      int v = events[i];
+      if (v == nv)
+        continue;
+      int ends[2] = { prev[v], v };
+      for(int k = 0; k < 2; ++k)
+      {
+        int e = ends[k];
+        if (num[e] && a[e] == v && slotOf[e] < 0)
+          insert(e);
+      }
+    }
+  }
+
+  if (degraded)
+  {
+    ++fallbacks;
+    for(int q = 0; q < p; ++q)
+      visible[q] = !edges->intersects(P, table[q]);
+  }
+}
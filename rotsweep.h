@@ -0,0 +1,142 @@
+#ifndef rotsweep_h
+#define rotsweep_h
+
+#include "world.h"
+#include "edgetable.h"
+
+#include <set>
+
+/*! Visibility from one node at a time by a rotational sweep
+
+   from(p) turns a ray around node p, stopping at every grown vertex in
+   angular order, and keeps the obstacle edges the ray crosses in a tree
+   ordered by how far along the ray they cross it. A node is visible when
+   the nearest edge crosses beyond it. That takes O(n log n) per node
+   instead of testing every edge for every other node, and gives the same
+   answers as EdgeTable::intersects, see rotsweep.cpp.
+
+   The sweep needs exact 128 bit products, and coordinates below 2^24.
+   assign returns false when it can't have them, and makeVisibility then
+   tests pairs.
+*/
+class RotationalSweep
+{
+public:
+  typedef World::coord coord;
+  typedef World::WPoint WPoint;
+
+  RotationalSweep();
+
+  //! a sweep over the same obstacles, so that several threads can sweep at once
+  RotationalSweep(RotationalSweep const & other);
+
+  //! load the grown obstacles and the nodes. false if the sweep can't be exact for them
+  bool assign(World const & world, NodeTable const & nodes, EdgeTable const & edges);
+
+  //! visible[q] for every node q < p: true if no obstacle edge crosses segment pq, the same as
+  //! !edges.intersects(nodes[p], nodes[q]). visible is resized to p
+  void from(int p, vector<char> & visible);
+
+  //! sweeps that met crossings they couldn't order and tested pairs instead
+  long fallbacks;
+
+private:
+  typedef _Point_wide<World::coord>::type wide;
+#ifdef __SIZEOF_INT128__
+  typedef __int128 huge;
+#else
+  typedef long long huge; // too small, assign refuses to sweep
+#endif
+
+  //! edges e1 and e2 cross at from(e1) + (to(e1) - from(e1)) * n / d, d > 0
+  struct Crossing
+  {
+    int e1, e2;
+    wide n, d;
+  };
+
+  World::GVertex const * gvertices;
+  NodeTable const * nodes;
+  EdgeTable const * edges;
+
+  //! edge i goes from vertex i to vertex next[i], and vertex i ends edge prev[i]
+  vector<int> next, prev;
+
+  //! node of each gvertex, -1 for vertices inside other shapes
+  vector<int> nodeOf;
+
+  //! pairs of edges of different shapes that cross away from their ends
+  vector<Crossing> crossings;
+
+  // state of one sweep
+  WPoint P;
+  wide dx, dy; //!< direction of the ray
+
+  //! ends of each edge, ordered counterclockwise around P
+  vector<int> a, b;
+
+  //! (a - P) x (b - P), 0 for edges on a line through P, which stay out of the tree
+  vector<wide> num;
+
+  //! b - a
+  vector<wide> ux, uy;
+
+  vector<int> through;
+
+  struct Nearer
+  {
+    RotationalSweep const * sweep;
+    bool operator()(int s, int t) const { return sweep->nearer(sweep->edgeAt[s], sweep->edgeAt[t]); }
+  };
+
+  typedef std::set<int, Nearer> Status;
+
+  //! the tree holds slots, which hold edges, so two edges that cross can trade places
+  Status status;
+  vector<int> edgeAt, slotOf, freeSlots;
+  vector<Status::iterator> where;
+
+  //! vertices less P, with the start node after them
+  vector<coord> rx, ry;
+
+  //! vertices, and next.size() for the start node, in counterclockwise order from +x
+  vector<int> events;
+  vector<std::pair<double, int> > keyed;
+
+  //! first event of each stop, a run of events in the same direction
+  vector<int> stops;
+
+  //! crossings in the order the ray meets them, with their directions from P
+  vector<int> order, place;
+  vector<double> angles;
+  vector<huge> cx, cy;
+
+  //! edges with an end on the ray
+  vector<int> touching;
+
+  //! edges crossing at one point
+  vector<int> block;
+
+  bool nearer(int e, int f) const;
+  bool blocked(WPoint Q) const;
+  void insert(int e);
+  void erase(int e);
+  //! put the edges of c in their order past it. false if edges that don't cross there are in between
+  bool swap(Crossing const & c);
+
+  //! edge g passes through the crossing
+  bool meets(int g, Crossing const & c) const;
+
+  //! gvertex v, or the start node for next.size()
+  WPoint point(int v) const
+  {
+    return v < (int)next.size() ? WPoint(gvertices[v]) : (*nodes)[0];
+  }
+
+  //! event v comes before event w
+  bool before(int v, int w) const;
+
+  RotationalSweep & operator=(RotationalSweep const &);
+};
+
+#endif
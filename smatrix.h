@@ -26,7 +26,7 @@ private:
   T * data;
   size_t dim;
 
-  size_t inline pos(size_t x, size_t y)
+  size_t inline pos(size_t x, size_t y) const
   {
     return x < y ? (y*(y+1))/2 + x : (x*(x+1))/2 + y;
   }
@@ -68,6 +68,23 @@ public:
   {
     return dim;
   }
+
+  //! number of elements actually stored, dim*(dim+1)/2
+  size_t elements() const
+  {
+    return pos(0,dim);
+  }
+
+  //! packed storage in the order shown above, elements() long
+  T * raw()
+  {
+    return data;
+  }
+
+  T const * raw() const
+  {
+    return data;
+  }
   
   void resize(size_t ndim)
   {
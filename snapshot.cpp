@@ -0,0 +1,175 @@
+#include "world.h"
+#include "general.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+
+Snapshot file layout
+
+  SnapshotHeader
+  shapes, vertices, gshapes, gvertices, slices, nodes, path,
+  isvisible and distanceCache packed lower triangles
+
+Each array is stored exactly as it is laid out in memory and starts on an
+8 byte boundary, so a mapped snapshot can be copied straight into the
+world's vectors without any parsing. The header records the sizes of the
+stored structures and the byte order, and a snapshot written by a build
+that doesn't match them is treated like a missing one.
+
+*/
+
+namespace
+{
+  const char SNAPSHOT_MAGIC[8] = { 'Q', 'M', 'S', 'N', 'A', 'P', '\r', '\n' };
+  const uint32_t SNAPSHOT_VERSION = 2;
+  const uint32_t SNAPSHOT_BYTEORDER = 0x01020304;
+
+  enum { SHAPES, VERTICES, GSHAPES, GVERTICES, SLICES, NODES, PATH, MATRIX, COUNTS };
+
+  struct SnapshotHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    uint32_t sizes[5]; // coord, Shape, Vertex, GVertex, Slice
+    uint64_t hash;
+    uint64_t counts[COUNTS];
+    World::GVertex start;
+    World::GVertex goal;
+  };
+
+  //! header must be value initialized, so the padding is zero too
+  void fillHeader(SnapshotHeader & header)
+  {
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteorder = SNAPSHOT_BYTEORDER;
+    header.sizes[0] = sizeof(World::coord);
+    header.sizes[1] = sizeof(World::Shape);
+    header.sizes[2] = sizeof(World::Vertex);
+    header.sizes[3] = sizeof(World::GVertex);
+    header.sizes[4] = sizeof(World::Slice);
+  }
+}
+
+uint64_t World::inputHash(GrowParameters const & parameters)
+{
+  static char const * const names[] = { NULL, "growShapes", "fgrowShapes", "growSlices" };
+  char const * growmethod = names[parameters.method];
+  if (!growmethod)
+    BARF("inputHash needs a grow method");
+
+  uint64_t h = hashBytes(growmethod, strlen(growmethod));
+  h = hashBytes(&parameters.amount, sizeof(parameters.amount), h);
+  if (parameters.method == GrowParameters::GROW_SLICES)
+    h = hashBytes(&parameters.slices, sizeof(parameters.slices), h);
+  h = hashBytes(robot, sizeof(WPoint) * DIM(robot), h);
+  if (mergeOverlaps) h = hashBytes("merged", 6, h); // leaves unmerged hashes as they were
+  if (bitangentsOnly) h = hashBytes("bitangent", 9, h);
+
+  uint64_t n = shapes.size();
+  h = hashBytes(&n, sizeof(n), h);
+  if (n) h = hashBytes(&shapes[0], n * sizeof(Shape), h);
+
+  n = vertices.size();
+  h = hashBytes(&n, sizeof(n), h);
+  if (n) h = hashBytes(&vertices[0], n * sizeof(Vertex), h);
+
+  n = startarea.size();
+  h = hashBytes(&n, sizeof(n), h);
+  if (n) h = hashBytes(&startarea[0], n * sizeof(WPoint), h);
+
+  n = goalarea.size();
+  h = hashBytes(&n, sizeof(n), h);
+  if (n) h = hashBytes(&goalarea[0], n * sizeof(WPoint), h);
+
+  return h;
+}
+
+void World::saveSnapshot(char const * filename, uint64_t hash)
+{
+  if (grownWith.method == GrowParameters::NONE || inputHash(grownWith) != hash)
+    BARF("Snapshot hash doesn't match the inputs and grow method the world was built with");
+
+  SnapshotHeader header = SnapshotHeader();
+  fillHeader(header);
+  header.hash = hash;
+  header.counts[SHAPES] = shapes.size();
+  header.counts[VERTICES] = vertices.size();
+  header.counts[GSHAPES] = gshapes.size();
+  header.counts[GVERTICES] = gvertices.size();
+  header.counts[SLICES] = slices.size();
+  header.counts[NODES] = nodes.size();
+  header.counts[PATH] = path.size();
+  header.counts[MATRIX] = isvisible.size();
+  header.start = start;
+  header.goal = goal;
+
+  CFile fp(filename, "wb");
+  writeSection(fp, &header, sizeof(header));
+  writeVector(fp, shapes);
+  writeVector(fp, vertices);
+  writeVector(fp, gshapes);
+  writeVector(fp, gvertices);
+  writeVector(fp, slices);
+  writeVector(fp, nodes);
+  writeVector(fp, path);
+  writeSection(fp, isvisible.raw(), isvisible.elements() * sizeof(bool));
+  writeSection(fp, distanceCache.raw(), distanceCache.elements() * sizeof(double));
+  fp.close();
+}
+
+bool World::loadSnapshot(char const * filename, uint64_t hash)
+{
+  FILE * probe = fopen(filename, "rb");
+  if (!probe) return false;
+  fclose(probe);
+
+  MappedFile file(filename);
+
+  SnapshotHeader expected = SnapshotHeader();
+  fillHeader(expected);
+
+  SnapshotHeader header = SnapshotHeader();
+  if (file.size() < padded(sizeof(header))) return false;
+  memcpy(&header, file.begin(), sizeof(header));
+
+  if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+      || header.version != expected.version
+      || header.byteorder != expected.byteorder
+      || memcmp(header.sizes, expected.sizes, sizeof(header.sizes)) != 0
+      || header.hash != hash)
+    return false;
+
+  uint64_t const * c = header.counts;
+  uint64_t triangle = c[MATRIX] * (c[MATRIX] + 1) / 2;
+  size_t expectedsize = padded(sizeof(header))
+    + padded(c[SHAPES] * sizeof(Shape)) + padded(c[VERTICES] * sizeof(Vertex))
+    + padded(c[GSHAPES] * sizeof(Shape)) + padded(c[GVERTICES] * sizeof(GVertex))
+    + padded(c[SLICES] * sizeof(Slice))
+    + padded(c[NODES] * sizeof(int)) + padded(c[PATH] * sizeof(int))
+    + padded(triangle * sizeof(bool)) + padded(triangle * sizeof(double));
+  if (file.size() != expectedsize) return false;
+
+  char const * p = file.begin() + padded(sizeof(header));
+  p = readVector(p, shapes, c[SHAPES]);
+  p = readVector(p, vertices, c[VERTICES]);
+  p = readVector(p, gshapes, c[GSHAPES]);
+  p = readVector(p, gvertices, c[GVERTICES]);
+  p = readVector(p, slices, c[SLICES]);
+  p = readVector(p, nodes, c[NODES]);
+  p = readVector(p, path, c[PATH]);
+
+  isvisible.resize(c[MATRIX]);
+  memcpy(isvisible.raw(), p, triangle * sizeof(bool));
+  p += padded(triangle * sizeof(bool));
+
+  distanceCache.resize(c[MATRIX]);
+  memcpy(distanceCache.raw(), p, triangle * sizeof(double));
+
+  start = header.start;
+  goal = header.goal;
+  return true;
+}
@@ -0,0 +1,226 @@
+#include "world.h"
+#include "general.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <iostream>
+#include <algorithm>
+
+using std::cerr;
+using std::endl;
+
+/*
+
+Saphira world files
+
+  ; comment
+  width 7360
+  height 20020
+  x0 y0 x1 y1
+  x0 y0 x1 y1
+  ...
+  position x y th
+
+Each numeric line is a wall segment. Keyword lines and comments are
+skipped. Segments are read in one pass straight from the mapped file and
+consecutive segments that share an endpoint are chained into polylines.
+A chain that closes on itself and is convex becomes a solid obstacle,
+like the boxes in obstacle.txt. Convex means every corner turns the same
+way or goes straight on, and the chain goes around once: a star turns
+the same way at every corner but goes around twice, so its edges switch
+between going up and going down more than twice. Every other segment becomes a thin wall
+polygon one unit wide, which is how walls were converted by hand before.
+
+*/
+
+namespace
+{
+  typedef World::coord coord;
+  typedef World::WPoint WPoint;
+
+  bool isSpace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  //! decode an integer at p and advance past it. false if there isn't one
+  bool readCoord(char const * & p, char const * end, coord & n)
+  {
+    while (p != end && isSpace(*p)) ++p;
+
+    bool negative = p != end && *p == '-';
+    if (negative) ++p;
+
+    char const * digits = p;
+    long value = 0;
+    unsigned digit;
+    while (p != end && (digit = (unsigned char)*p - '0') < 10)
+    {
+      value = value * 10 + digit;
+      ++p;
+    }
+    n = (coord)(negative ? -value : value);
+    return p != digits;
+  }
+
+  /*! true if the closed chain is convex, see above, and then turns it
+      counterclockwise. Turns are exact, like convexHull's.
+  */
+  bool orientConvex(vector<WPoint> & chain)
+  {
+    typedef _Point_wide<coord>::type wide;
+
+    size_t n = chain.size();
+    int sign = 0;
+    int ychanges = 0;
+    int firsty = 0, lasty = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+      WPoint const & A = chain[i];
+      WPoint const & B = chain[(i + 1) % n];
+      WPoint const & C = chain[(i + 2) % n];
+
+      wide turn = _convexHull_turn(A, B, C);
+      if (turn == 0)
+      {
+        // going straight on is fine, doubling back isn't
+        if (((wide)B.x - A.x) * ((wide)C.x - B.x) + ((wide)B.y - A.y) * ((wide)C.y - B.y) < 0)
+          return false;
+      }
+      else
+      {
+        int s = turn > 0 ? 1 : -1;
+        if (sign != 0 && s != sign)
+          return false;
+        sign = s;
+      }
+
+      int y = B.y > A.y ? 1 : B.y < A.y ? -1 : 0;
+      if (y != 0)
+      {
+        if (firsty == 0)
+          firsty = y;
+        else if (y != lasty)
+          ++ychanges;
+        lasty = y;
+      }
+    }
+    if (lasty != firsty) // wrap around to the first edge going up or down
+      ++ychanges;
+
+    if (sign == 0 || ychanges > 2)
+      return false;
+    if (sign < 0)
+      std::reverse(chain.begin(), chain.end());
+    return true;
+  }
+
+  //! builds shapes from chains of wall segments
+  class ChainBuilder
+  {
+  public:
+    ChainBuilder(vector<World::Vertex> & vertices_, vector<World::Shape> & shapes_)
+    : vertices(vertices_), shapes(shapes_) { }
+
+    void segment(WPoint a, WPoint b)
+    {
+      if (chain.empty() || !chain.back().equals(a))
+      {
+        flush();
+        chain.push_back(a);
+      }
+      chain.push_back(b);
+    }
+
+    //! turn the current chain into shapes
+    void flush()
+    {
+      if (chain.size() >= 2)
+      {
+        if (chain.size() > 3 && chain.front().equals(chain.back()))
+        {
+          chain.pop_back(); // closing vertex
+          if (orientConvex(chain))
+          {
+            addShape(chain.begin(), chain.end());
+            chain.resize(0);
+            return;
+          }
+          chain.push_back(chain.front());
+        }
+
+        for(size_t i = 1; i < chain.size(); ++i)
+          addWall(chain[i-1], chain[i]);
+      }
+      chain.resize(0);
+    }
+
+  private:
+    vector<World::Vertex> & vertices;
+    vector<World::Shape> & shapes;
+    vector<WPoint> chain;
+
+    template<class InputIterator>
+    void addShape(InputIterator begin, InputIterator end)
+    {
+      int shapeno = shapes.size();
+      int startidx = vertices.size();
+      for(InputIterator i = begin; i != end; ++i)
+        vertices.push_back(World::Vertex(*i, shapeno));
+      shapes.push_back(World::Shape(startidx, vertices.size() - startidx));
+    }
+
+    void addWall(WPoint a, WPoint b)
+    {
+      if (a.equals(b)) return;
+
+      // thicken across the wall's narrower extent
+      WPoint d = b - a;
+      WPoint offset = abs(d.x) >= abs(d.y) ? WPoint(0,1) : WPoint(1,0);
+
+      WPoint wall[] = { a, b, b + offset, a + offset };
+      addShape(wall, wall + DIM(wall));
+    }
+  };
+}
+
+void World::readWorldFile(char const * filename)
+{
+  // clear out existing data
+  shapes.resize(0);
+  vertices.resize(0);
+
+  MappedFile file(filename);
+  ChainBuilder builder(vertices, shapes);
+
+  int lineno = 0;
+  for(char const * line = file.begin(); line != file.end(); )
+  {
+    ++lineno;
+    char const * eol = (char const *)memchr(line, '\n', file.end() - line);
+    if (!eol) eol = file.end();
+
+    char const * p = line;
+    while (p != eol && isSpace(*p)) ++p;
+
+    if (p == eol) // blank line, ends a chain
+      builder.flush();
+    else if (isdigit((unsigned char)*p) || *p == '-')
+    {
+      coord c[4];
+      int fields = 0;
+      while (fields < 4 && readCoord(p, eol, c[fields]))
+        ++fields;
+
+      if (fields == 4)
+        builder.segment(WPoint(c[0], c[1]), WPoint(c[2], c[3]));
+      else
+        cerr << "Parse error on line " << lineno << " of " << filename << ". Segment has " << fields << " coordinates instead of 4" << endl;
+    }
+    // anything else is a keyword or comment line
+
+    line = eol == file.end() ? eol : eol + 1;
+  }
+  builder.flush();
+}
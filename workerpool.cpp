@@ -0,0 +1,96 @@
+#include "workerpool.h"
+
+WorkerPool::WorkerPool(int threads)
+: task(NULL), items(0), next(0), busy(0), generation(0), stopping(false)
+{
+  if (threads <= 0)
+    threads = std::thread::hardware_concurrency();
+
+  for(int i = 1; i < threads; ++i)
+    workers.push_back(std::thread(&WorkerPool::work, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for(size_t i = 0; i < workers.size(); ++i)
+    workers[i].join();
+}
+
+void WorkerPool::run(int n, Task const & task_)
+{
+  if (n <= 0) return;
+
+  if (workers.empty() || n == 1) // not worth waking anybody
+  {
+    for(int i = 0; i < n; ++i)
+      task_(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    task = &task_;
+    items = n;
+    next = 0;
+    busy = workers.size();
+    error = std::exception_ptr();
+    ++generation;
+  }
+  wake.notify_all();
+
+  drain();
+
+  std::exception_ptr e;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (busy > 0)
+      done.wait(lock);
+    task = NULL;
+    e = error;
+  }
+  if (e) std::rethrow_exception(e);
+}
+
+void WorkerPool::work()
+{
+  unsigned seen = 0;
+  for(;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (!stopping && generation == seen)
+        wake.wait(lock);
+      if (stopping) return;
+      seen = generation;
+    }
+
+    drain();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--busy == 0) done.notify_one();
+    }
+  }
+}
+
+void WorkerPool::drain()
+{
+  for(int i; (i = next++) < items; )
+  {
+    try
+    {
+      (*task)(i);
+    }
+    catch(...)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) error = std::current_exception();
+      next = items; // don't start anything else
+    }
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef workerpool_h
+#define workerpool_h
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+/*! Fixed set of worker threads
+
+   run(n, task) calls task(i) for every i in [0, n) using the workers and
+   the calling thread, and returns once all of the calls are done. Items
+   are handed out one at a time from a shared counter, so threads that
+   finish early keep taking items until there are none left. If a task
+   throws, the first exception is rethrown from run().
+
+   Only one run() may be in progress at a time.
+*/
+class WorkerPool
+{
+public:
+  typedef std::function<void(int)> Task;
+
+  //! threads includes the calling thread. 0 means one per hardware thread
+  WorkerPool(int threads = 0);
+  ~WorkerPool();
+
+  //! number of threads that take part in run(), including the caller
+  int size() const
+  {
+    return workers.size() + 1;
+  }
+
+  void run(int n, Task const & task);
+
+private:
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+
+  // current job
+  Task const * task;
+  int items;
+  std::atomic<int> next;
+  int busy;
+  unsigned generation;
+  bool stopping;
+  std::exception_ptr error;
+
+  void work();
+  void drain();
+
+  WorkerPool(WorkerPool const &);
+  WorkerPool & operator=(WorkerPool const &);
+};
+
+#endif
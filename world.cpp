@@ -1,5 +1,11 @@
 #include "world.h"
 #include "point.h"
+#include "workerpool.h"
+#include "edgetable.h"
+#include "footprint.h"
+#include "growcache.h"
+#include "rotsweep.h"
+#include "edgegrid.h"
 
 #include <stdio.h>
 #include <string>
@@ -11,226 +17,1183 @@
 #include <iomanip>
 #include <cfloat>
 #include <sstream>
+#include <string.h>
+#include <chrono>
 
 using std::cout;
 
 using std::string;
 using std::setw;
 using std::endl;
-using std::stable_sort;
 using std::make_heap;
 using std::pop_heap;
 using std::copy;
 using std::reverse;
 using std::stringstream;
 
-// the first four points are the vertices of the robot.
-// the last point is the robot's reference point (center)
-// These were the dimensions given, but the pioneer robot in the saphira module is larger
+// the corners of the robot, then the robot's reference point (center)
 
-World::WPoint World::robot[] = 
-{
-  WPoint(0,0),
-  WPoint(370,0),
-  WPoint(370,550),
-  WPoint(0,550),
-  WPoint(185, 275) 
-};
+World::WPoint World::robot[PioneerFootprint::CORNERS + 1];
+
+static_assert(PioneerFootprint::convex(), "robot corners must be strictly convex and counterclockwise");
+static bool _World_robot_filled = PioneerFootprint::copy(World::robot, DIM(World::robot));
 
 // TODO: some repetetive code for loading hulls into point and shape
 // arrays can be factored out into a seperate method or class, or possibly
 // built into the hull function itself. avoid unneccessary bookeeping by 
 // making it more generic
 
+//! record what the shapes from firstshape on are grown with. shapes kept from before it have to
+//! have been grown the same way for the whole set to be described by parameters
+static void _World_grownWith(World & world, World::GrowParameters const & parameters, int firstshape)
+{
+  world.grownWith = firstshape == 0 || world.grownWith == parameters ? parameters : World::GrowParameters();
+}
+
+void World::grow(GrowParameters const & parameters)
+{
+  switch (parameters.method)
+  {
+  case GrowParameters::GROW_SHAPES:
+    growShapes(parameters.amount);
+    break;
+  case GrowParameters::FGROW_SHAPES:
+    fgrowShapes(parameters.amount);
+    break;
+  case GrowParameters::GROW_SLICES:
+    growSlices(parameters.slices, parameters.amount);
+    break;
+  default:
+    BARF("grow needs a grow method");
+  }
+}
+
 /* returns grown version of h, keeping h intact */
 /* pre: h is a convex polygon in counterclockwise order */
-void World::fgrowShapes(double amount)
+void World::fgrowShapes(double amount, int firstshape)
 {
   assert(amount > 0);
+
+  // slices don't line up with the obstacles, grow them all again
+  if (!slices.empty())
+    firstshape = 0;
+  slices.resize(0);
+  _World_grownWith(*this, GrowParameters(GrowParameters::FGROW_SHAPES, amount), firstshape);
+
+  assert(firstshape <= gshapes.size() && firstshape <= shapes.size());
   
-  // copy and reorient original shapes
+  // copy and reorient original shapes, keeping the ones grown already.
+  // grown vertices line up with the original vertices in this method
   
   typedef vector<Vertex>::iterator vi;
-  gshapes = shapes;
+  gshapes.resize(firstshape);
+  gshapes.insert(gshapes.end(), shapes.begin() + firstshape, shapes.end());
   gvertices.resize(vertices.size());
-  int lastshape = 0;
-  vi lasti = vertices.begin();
-  for(vi i = lasti; ; ++i)
+
+  // the shapes are independent. with enough of them, runs of shapes go to
+  // the workers, a few per thread so uneven ones even out
+  int count = shapes.size() - firstshape;
+  int runs = workers && count >= PARALLEL_GROW_SHAPES ? workers->size() * 4 : 1;
+
+  // shapes the cache doesn't have, by run, to add once the runs are done
+  uint64_t method = GrowCache::method("fgrowShapes", &amount, sizeof(amount));
+  vector<vector<std::pair<uint64_t, int> > > fresh(runs);
+  vector<long> hits(runs);
+
+  WorkerPool::Task grow = [&](int run)
   {
-    bool done = i == vertices.end();
-    
-    if (done || i->shapeno !=lastshape)
+    vector<GVertex> cached;
+    vector<Shape>::const_iterator begin = shapes.begin() + firstshape + (long)count * run / runs;
+    vector<Shape>::const_iterator end = shapes.begin() + firstshape + (long)count * (run + 1) / runs;
+    for(vector<Shape>::const_iterator shape = begin; shape != end; ++shape) // for each shape
     {
-      orient_poly<Vertex,vi>(lasti,i);
-      lasti = i;
-    }
-    if (done) break;
-    
-    lastshape = i->shapeno;
-    int n = i - vertices.begin();
-    gvertices[n] = GVertex(*i,n);
-  }
-  
-  for(vector<Shape>::const_iterator shape = shapes.begin(); shape != shapes.end(); ++shape) // for each shape
-  {
-    int sv = shape->startidx; // start vertex
-    int nv = shape->vertices; // number of vertices
-    int ev = sv + nv;
+      int sv = shape->startidx; // start vertex
+      int nv = shape->vertices; // number of vertices
+      int ev = sv + nv;
+
+      for(int n = sv; n < ev; ++n)
+        gvertices[n] = GVertex(vertices[n],n);
+      orient_poly<Vertex,vi>(vertices.begin() + sv, vertices.begin() + ev);
+
+      if (growCache)
+      {
+        uint64_t key = GrowCache::key(method, &vertices[sv], nv);
+        cached.resize(0);
+        if (growCache->find(key, &vertices[sv], nv, shape - shapes.begin(), sv, cached) && cached.size() == nv)
+        {
+          for(int n = 0; n < nv; ++n)
+          {
+            gvertices[sv + n].x = cached[n].x;
+            gvertices[sv + n].y = cached[n].y;
+          }
+          ++hits[run];
+          continue;
+        }
+        fresh[run].push_back(std::make_pair(key, (int)(shape - shapes.begin())));
+      }
       
-    /* error checking not fully implemented */
-    /*  int done; */
-    double j, k;
-    WPoint mCA, mAB, mCE, mBD; /* treated like vectors */
-    WPoint D, E; /* treated like points */
+      /* error checking not fully implemented */
+      /*  int done; */
+      double j, k;
+      WPoint mCA, mAB, mCE, mBD; /* treated like vectors */
+      WPoint D, E; /* treated like points */
     
-    for(int e = sv; e < ev; ++e) // for each edge of shape
-    {
-      Vertex & prev = vertices[(e-sv-1+nv) % nv + sv];
-      Vertex & p = vertices[e];
-      Vertex & next = vertices[(e-sv+1)%nv + sv];
-      GVertex & q = gvertices[e];
+      for(int e = sv; e < ev; ++e) // for each edge of shape
+      {
+        Vertex & prev = vertices[(e-sv-1+nv) % nv + sv];
+        Vertex & p = vertices[e];
+        Vertex & next = vertices[(e-sv+1)%nv + sv];
+        GVertex & q = gvertices[e];
       
-      mCA = p - prev; 
-      mAB = next - p;
-      mCE = mCA.rot_by_90();
-      mBD = mAB.rot_by_90();
+        mCA = p - prev; 
+        mAB = next - p;
+        mCE = mCA.rot_by_90();
+        mBD = mAB.rot_by_90();
       
-      mCE.diametrize(amount);
-      mBD.diametrize(amount);
-      E = prev + mCE;
-      D = next + mBD;
+        mCE.diametrize(amount);
+        mBD.diametrize(amount);
+        E = prev + mCE;
+        D = next + mBD;
       
-      /* NOT CHECKING FOR pathological (i.e., non-convex) cases */
-      /* this means that we assume that the lines intersect. */
+        /* NOT CHECKING FOR pathological (i.e., non-convex) cases */
+        /* this means that we assume that the lines intersect. */
     
-      /* the point we want (A') is the intersection of lines */
+        /* the point we want (A') is the intersection of lines */
       
-      /* (1) <Dx, Dy> + k <mABx, mABy>
-       *  and
-       * (2) <Ex, Ey> + j <mCAx, mCAy>
+        /* (1) <Dx, Dy> + k <mABx, mABy>
+         *  and
+         * (2) <Ex, Ey> + j <mCAx, mCAy>
       
-       * for the point of intersection:
-       * x-coord = Dx + k (mABx) = Ex + j (mCAx)
-       * y-coord = Dy + k (mABy) = Ey + j (mCAy)
-       * for unique (k, j)
-       */
+         * for the point of intersection:
+         * x-coord = Dx + k (mABx) = Ex + j (mCAx)
+         * y-coord = Dy + k (mABy) = Ey + j (mCAy)
+         * for unique (k, j)
+         */
       
-      j= (D.x * mAB.y - D.y * mAB.x - E.x * mAB.y + E.y * mAB.x) /
-        (mCA.x * mAB.y - mCA.y * mAB.x);
+        j= (D.x * mAB.y - D.y * mAB.x - E.x * mAB.y + E.y * mAB.x) /
+          (mCA.x * mAB.y - mCA.y * mAB.x);
       
-      if(mAB.y != 0.0) {
-        k = (E.y + j * mCA.y - D.y)/mAB.y;
-      } else if(mAB.x != 0.0) {
-        k = (E.x + j * mCA.x - D.x)/mAB.x;
-      } else {
-        /* oh well.  so much for not checking. */
-        stringstream msg;
-        msg << "big bug: two adjacent vertices coincide! (" << p.x << "," << p.y << ")";
-        BARF(msg.str());
-      }
+        if(mAB.y != 0.0) {
+          k = (E.y + j * mCA.y - D.y)/mAB.y;
+        } else if(mAB.x != 0.0) {
+          k = (E.x + j * mCA.x - D.x)/mAB.x;
+        } else {
+          /* oh well.  so much for not checking. */
+          stringstream msg;
+          msg << "big bug: two adjacent vertices coincide! (" << p.x << "," << p.y << ")";
+          BARF(msg.str());
+        }
       
-      q.x = D.x + k * mAB.x;
-      q.y = D.y + k * mAB.y;
-      /* done calculating q->pt.x and q->pt.y */
-    }    
+        q.x = D.x + k * mAB.x;
+        q.y = D.y + k * mAB.y;
+        /* done calculating q->pt.x and q->pt.y */
+      }    
+    }
+  };
+
+  if (runs > 1)
+    workers->run(runs, grow);
+  else
+    grow(0);
+
+  if (growCache)
+    for(int run = 0; run < runs; ++run)
+    {
+      growCache->hits += hits[run];
+      growCache->misses += fresh[run].size();
+      for(size_t f = 0; f < fresh[run].size(); ++f)
+      {
+        Shape const & shape = shapes[fresh[run][f].second];
+        growCache->insert(fresh[run][f].first, &vertices[shape.startidx], shape.vertices,
+          &gvertices[shape.startidx], shape.vertices, shape.startidx);
+      }
+    }
+};
+
+/*! Grows convex obstacles by the robot with a Minkowski sum
+
+   The sum of two convex polygons can be walked by merging their edges in
+   order of direction, starting from the sum of their lowest points. That
+   takes O(n + m) and needs no trig or sorting. The result has the same
+   vertices as the hull of every obstacle vertex plus every robot corner.
+   Each grown vertex keeps the shapeno and vertexno of the obstacle
+   vertex it came from, like the hull engine's do.
+
+   Only strictly convex obstacles, in either orientation, are grown this
+   way. For anything else grow() returns false and growShapes falls back to
+   the hull engine, so when an obstacle repeats a vertex, the grown vertex
+   gets the same vertexno from either engine.
+*/
+class _World_growShapes_minkowski
+{
+public:
+  typedef World::WPoint WPoint;
+  typedef World::GVertex GVertex;
+  typedef _Point_wide<World::coord>::type wide;
+
+  //! corners are relative to the robot's reference point
+  _World_growShapes_minkowski(vector<WPoint> const & corners)
+  : valid(order(corners))
+  {
+  }
+
+  //! append the grown obstacle to out. false if the obstacle isn't strictly convex or the robot is degenerate
+  bool grow(vector<GVertex> const & obstacle, vector<GVertex> & out)
+  {
+    if (!valid || obstacle.size() < 3)
+      return false;
+
+    int orientation = convexOrientation(obstacle);
+    if (orientation > 0)
+      hull.assign(obstacle.begin(), obstacle.end());
+    else if (orientation < 0)
+      hull.assign(obstacle.rbegin(), obstacle.rend());
+    else
+      return false;
+
+    size_t n = hull.size(), m = robot.size();
+    size_t a = lowest(hull);
+    size_t first = out.size();
+    for(size_t i = 0, j = 0; i < n || j < m; )
+    {
+      GVertex const & A = hull[(a + i) % n];
+      WPoint const & B = robot[j % m];
+      out.push_back(GVertex(A + B, A.shapeno, A.vertexno));
+
+      WPoint ea = hull[(a + i + 1) % n] - A;
+      WPoint const & eb = edges[j % m];
+      wide turn = (wide)ea.x * eb.y - (wide)ea.y * eb.x;
+      if (turn >= 0 && i < n) ++i;
+      if (turn <= 0 && j < m) ++j;
+    }
+
+    // start from the lowest, rightmost point like convexHull
+    size_t pivot = first;
+    for(size_t i = first + 1; i < out.size(); ++i)
+      if (out[i].y < out[pivot].y || (out[i].y == out[pivot].y && out[i].x > out[pivot].x))
+        pivot = i;
+    std::rotate(out.begin() + first, out.begin() + pivot, out.end());
+    return true;
+  }
+
+private:
+  vector<WPoint> robot; // counterclockwise from the lowest corner
+  vector<WPoint> edges; // edges[j] goes from robot[j] to the next corner
+  bool valid;
+  vector<GVertex> hull;
+
+  //! fill robot and edges counterclockwise from the lowest corner. false if the robot is degenerate
+  bool order(vector<WPoint> const & corners)
+  {
+    vector<WPoint> points(corners), scratch;
+    if (points.size() < 3)
+      return false;
+    points.erase(convexHull(points.begin(), points.end(), points.begin(), scratch), points.end());
+    if (points.size() < 3)
+      return false;
+
+    size_t m = points.size(), b = lowest(points);
+    robot.resize(m);
+    edges.resize(m);
+    for(size_t j = 0; j < m; ++j)
+    {
+      robot[j] = points[(b + j) % m];
+      edges[j] = points[(b + j + 1) % m] - points[(b + j) % m];
+    }
+    return true;
+  }
+
+  //! 1 if strictly convex and counterclockwise, -1 if clockwise, 0 otherwise
+  static int convexOrientation(vector<GVertex> const & p)
+  {
+    size_t n = p.size();
+    int sign = 0;
+    int ychanges = 0;
+    int lasty = 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+      wide turn = _convexHull_turn<World::coord>(p[i], p[(i + 1) % n], p[(i + 2) % n]);
+      int s = turn > 0 ? 1 : turn < 0 ? -1 : 0;
+      if (s == 0 || (sign != 0 && s != sign))
+        return 0;
+      sign = s;
+
+      // turning the same way everywhere isn't enough, a star turns
+      // around twice. count the times the edges change vertical direction
+      int y = p[(i + 1) % n].y > p[i].y ? 1 : p[(i + 1) % n].y < p[i].y ? -1 : 0;
+      if (y != 0)
+      {
+        if (lasty != 0 && y != lasty) ++ychanges;
+        lasty = y;
+      }
+    }
+    for(size_t i = 0; i < n && lasty != 0; ++i) // wrap around to the first vertical direction
+    {
+      int y = p[(i + 1) % n].y > p[i].y ? 1 : p[(i + 1) % n].y < p[i].y ? -1 : 0;
+      if (y != 0)
+      {
+        if (y != lasty) ++ychanges;
+        break;
+      }
+    }
+    return ychanges <= 2 ? sign : 0;
+  }
+
+  //! index of the lowest, leftmost point
+  template<class PointType>
+  static size_t lowest(vector<PointType> const & p)
+  {
+    size_t l = 0;
+    for(size_t i = 1; i < p.size(); ++i)
+      if (p[i].y < p[l].y || (p[i].y == p[l].y && p[i].x < p[l].x))
+        l = i;
+    return l;
   }
 };
 
-void World::growShapes(double mult = 1.0)
+/*! Grows a run of shapes into arrays of its own
+
+   growShapes splits the shapes into runs for the workers. Each run has its
+   own scratch space, and its grown shapes start at vertex 0 of its own
+   array until they are put together in shape order. With a cache, shapes
+   found there are copied and the rest are listed in fresh, for the
+   calling thread to add to the cache once the runs are done.
+*/
+class _World_growShapes_run
+{
+public:
+  typedef World::Shape Shape;
+  typedef World::GVertex GVertex;
+
+  vector<Shape> nshapes;
+  vector<GVertex> nvertices;
+
+  //! cache keys of the shapes that weren't in the cache, and their index in nshapes
+  vector<std::pair<uint64_t, int> > fresh;
+  long hits;
+
+  //! grow shapes [begin, end). method is the cache key of the corners, for a cache that isn't NULL
+  void grow(World & world, vector<World::WPoint> const & corners, int begin, int end, GrowCache const * cache, uint64_t method)
+  {
+    vector<Shape> & shapes = world.shapes;
+    vector<World::Vertex> & vertices = world.vertices;
+    size_t vertexno = 0;
+    hits = 0;
+
+    typedef vector<Shape>::const_iterator ishape;
+    
+    _World_growShapes_minkowski minkowski(corners);
+
+    // grow each shape   
+    for(ishape shape = shapes.begin() + begin; shape != shapes.begin() + end; ++shape) // for each shape
+    {
+      size_t before = nvertices.size();
+      if (cache)
+      {
+        uint64_t key = cache->key(method, &vertices[shape->startidx], shape->vertices);
+        if (cache->find(key, &vertices[shape->startidx], shape->vertices, shape - shapes.begin(), shape->startidx, nvertices))
+          ++hits;
+        else
+        {
+          fresh.push_back(std::make_pair(key, (int)nshapes.size()));
+          growShape(world, corners, minkowski, shape - shapes.begin());
+        }
+      }
+      else
+        growShape(world, corners, minkowski, shape - shapes.begin());
+
+      nshapes.push_back(Shape(vertexno, nvertices.size() - before));
+      vertexno += nvertices.size() - before;
+    }
+  }
+
+private:
+  // scratch variables
+  vector<GVertex> points;
+  vector<GVertex> hull;
+  vector<GVertex> hullscratch;
+
+  //! append shape s grown to nvertices
+  void growShape(World & world, vector<World::WPoint> const & corners, _World_growShapes_minkowski & minkowski, int s)
+  {
+    World::Shape const & shape = world.shapes[s];
+    vector<World::Vertex> & vertices = world.vertices;
+    if (world.growEngine == World::GROW_MINKOWSKI)
+    {
+      points.resize(0);
+      for(int v = shape.startidx; v < shape.startidx + shape.vertices; ++v)
+        points.push_back(GVertex(vertices[v], s, v));
+
+      if (minkowski.grow(points, nvertices))
+        return;
+    }
+
+    size_t m = corners.size();
+    points.resize(shape.vertices * m);
+    
+    for(int v = shape.startidx; v < shape.startidx + shape.vertices; ++v) // for each vertex
+    {
+      // find the robot's reference positions when each of its vertices touches the obstacle vertex
+      // load these positions into the "points" array
+      for(size_t rv = 0; rv < m; ++rv) // for each robot vertex
+        points[(v - shape.startidx) * m + rv] = GVertex(vertices[v] + corners[rv], s, v);
+    }
+
+    // take the outermost shape made from these points
+    hull.resize(points.size());
+    vector<GVertex>::iterator hb = hull.begin(); // need a non constant iterator
+    vector<GVertex>::iterator hullend = convexHull(points.begin(), points.end(), hb, hullscratch);
+    
+    // store the results
+    nvertices.insert(nvertices.end(), hull.begin(), hullend);
+  }
+};
+
+/*! Grow cache lookups of one _World_growShapes_grow
+
+   The cache can't be added to while other threads look shapes up in it,
+   so a call running on a worker hands its misses back, and the calling
+   thread stores them once the workers are done.
+*/
+struct _World_growShapes_misses
+{
+  typedef World::GVertex GVertex;
+
+  long hits;
+
+  //! cache key and obstacle of each miss
+  vector<uint64_t> keys;
+  vector<int> shapenos;
+
+  //! grown vertices of miss i are grown[first[i]] through grown[first[i+1]-1]
+  vector<int> first;
+  vector<GVertex> grown;
+
+  _World_growShapes_misses() : hits(0), first(1, 0) { }
+
+  void add(uint64_t key, int shapeno, GVertex const * vertices, int n)
+  {
+    keys.push_back(key);
+    shapenos.push_back(shapeno);
+    grown.insert(grown.end(), vertices, vertices + n);
+    first.push_back(grown.size());
+  }
+
+  //! count the lookups and add the misses to the cache
+  void store(World & world, GrowCache & cache) const
+  {
+    cache.hits += hits;
+    cache.misses += keys.size();
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+      World::Shape const & shape = world.shapes[shapenos[i]];
+      cache.insert(keys[i], &world.vertices[shape.startidx], shape.vertices,
+        &grown[first[i]], first[i + 1] - first[i], shape.startidx);
+    }
+  }
+};
+
+//! grow the shapes from firstshape on by the robot corners, which are relative to its reference point.
+//! the grown shapes are appended to gshapes and gvertices. workers may be NULL. misses collects the
+//! grow cache misses for the caller to store, NULL to store them before returning
+static void _World_growShapes_grow(World & world, vector<World::WPoint> const & corners, int firstshape,
+  vector<World::Shape> & gshapes, vector<World::GVertex> & gvertices, WorkerPool * workers,
+  _World_growShapes_misses * misses = NULL)
+{
+  typedef World::Shape Shape;
+  typedef World::GVertex GVertex;
+  typedef _World_growShapes_run Run;
+
+  // the corners already carry the robot outline, the multiplier and the heading
+  GrowCache * cache = world.growCache;
+  uint64_t method = 0;
+  if (cache)
+    method = GrowCache::method("growShapes", &corners[0], corners.size() * sizeof(World::WPoint));
+
+  // a few runs per thread so uneven ones even out
+  int count = world.shapes.size() - firstshape;
+  int n = workers && count >= World::PARALLEL_GROW_SHAPES ? workers->size() * 4 : 1;
+  vector<Run> runs(n);
+  WorkerPool::Task grow = [&](int k)
+  {
+    runs[k].grow(world, corners, firstshape + (long)count * k / n, firstshape + (long)count * (k + 1) / n, cache, method);
+  };
+  if (n > 1)
+    workers->run(n, grow);
+  else
+    grow(0);
+
+  // temporary storage for grown shapes, in shape order
+  vector<Shape> nshapes;
+  vector<GVertex> nvertices;  
+  _World_growShapes_misses local;
+  _World_growShapes_misses & found = misses ? *misses : local;
+  for(int k = 0; k < n; ++k)
+  {
+    Run & run = runs[k];
+    if (cache)
+    {
+      found.hits += run.hits;
+      for(size_t f = 0; f < run.fresh.size(); ++f)
+      {
+        Shape const & grown = run.nshapes[run.fresh[f].second];
+        found.add(run.fresh[f].first, firstshape + nshapes.size() + run.fresh[f].second,
+          &run.nvertices[grown.startidx], grown.vertices);
+      }
+    }
+
+    int vertexoffset = gvertices.size() + nvertices.size();
+    for(size_t i = 0; i < run.nshapes.size(); ++i)
+      nshapes.push_back(Shape(run.nshapes[i].startidx + vertexoffset, run.nshapes[i].vertices));
+    nvertices.insert(nvertices.end(), run.nvertices.begin(), run.nvertices.end());
+  }
+  
+  // merge overlapping shapes until the merged hulls stop overlapping
+  if (world.mergeOverlaps)
+  {
+    vector<Shape> mshapes;
+    vector<GVertex> mvertices;
+    while (world.noIntersect(nshapes, nvertices, mshapes, mvertices))
+    {
+      nshapes.swap(mshapes);
+      nvertices.swap(mvertices);
+    }
+  }
+  
+  gshapes.insert(gshapes.end(), nshapes.begin(), nshapes.end());
+  gvertices.insert(gvertices.end(), nvertices.begin(), nvertices.end());
+
+  if (cache && !misses)
+    local.store(world, *cache);
+}
+
+//! drop grown shapes from firstshape on, before growing them again with parameters. returns the first shape to grow
+static int _World_growShapes_keep(World & world, int firstshape, World::GrowParameters const & parameters)
+{
+  // merged shapes and slices don't line up with the obstacles, grow them all again
+  if (world.mergeOverlaps || !world.slices.empty())
+    firstshape = 0;
+  world.slices.resize(0);
+  _World_grownWith(world, parameters, firstshape);
+
+  assert(firstshape <= world.gshapes.size() && firstshape <= world.shapes.size());
+  world.gshapes.resize(firstshape);
+  world.gvertices.resize(firstshape > 0 ? world.gshapes.back().startidx + world.gshapes.back().vertices : 0);
+  return firstshape;
+}
+
+void World::growShapes(double mult = 1.0, int firstshape)
 {
   // Uses the algorithm in appendix A of the first reference cited in lozano.ps
   // Grows each obstacle by the shape of the robot, but does not take into
   // account robot rotation.
 
-  // m multiplies the size of the robot before growing it into each of the shapes
-  // this seems to be neccessary because the provided dimensions are a bit
-  // to small to work for the saphira simulator
-  
-  // After the shapes are grown, this code checks to see if they overlap.
-  // If two grown shapes overlap, they are merged into one.
-  
-  // temporary storage for grown shapes  
-  vector<Shape> nshapes;
-  vector<GVertex> nvertices;  
-  size_t vertexno = 0;  
+  // m multiplies the size of the robot before growing it into each of the shapes
+  // this seems to be neccessary because the provided dimensions are a bit
+  // to small to work for the saphira simulator
+  
+  // After the shapes are grown, this code checks to see if they overlap.
+  // If two grown shapes overlap, they are merged into one.
+  
+  // Shapes before firstshape were grown by an earlier call and are kept.
+
+  // growing with the outline keeps the same shapes, and forgets the parameters
+  firstshape = _World_growShapes_keep(*this, firstshape, GrowParameters(GrowParameters::GROW_SHAPES, mult));
+  GrowParameters parameters = grownWith;
+  growShapes(vector<WPoint>(robot, robot + DIM(robot)), mult, firstshape);
+  grownWith = parameters;
+}
+
+//! append the corners of a robot outline, scaled by mult, relative to its scaled reference point
+static void _World_growShapes_outline(vector<World::WPoint> const & outline, double mult, vector<World::WPoint> & corners)
+{
+  typedef World::WPoint WPoint;
+
+  vector<WPoint> mrobot;
+  for(int rv = 0; rv < outline.size(); ++rv)
+    mrobot.push_back(WPoint(outline[rv].x * mult, outline[rv].y * mult));
+
+  // rreference points to the robot's reference point
+  WPoint & rreference = mrobot.back();
+
+  for(int rv = 0; rv < mrobot.size()-1; ++rv)
+    corners.push_back(mrobot[rv] - rreference);
+}
+
+void World::growShapes(vector<WPoint> const & outline, double mult, int firstshape)
+{
+  assert(outline.size() >= 2);
+  firstshape = _World_growShapes_keep(*this, firstshape, GrowParameters());
+
+  vector<WPoint> corners;
+  _World_growShapes_outline(outline, mult, corners);
+  _World_growShapes_grow(*this, corners, firstshape, gshapes, gvertices, workers);
+}
+
+/*
+
+Configuration space slices
+
+growShapes grows the obstacles by the robot at one heading. growSlices
+grows them for k headings instead, turning robot about its reference
+point by pi * s / k for slice s. The robot can drive a segment forwards
+or in reverse, so each slice is grown by the robot at its heading and
+turned half way round, which is the same outline for a robot that is
+symmetric about its reference point. The robot's outline in robot faces
++y, along its longer side.
+
+A segment whose direction lies between the headings of slices s and s+1
+is in sector s, and it has to be clear of the obstacles in both slices.
+The graph nodes are the start, the goal, and the grown vertices of every
+slice. The robot turns on the spot at a node, so a vertex of slice s can
+end segments in the sectors it can turn to: those within the run of
+slices around s where it isn't inside an obstacle. The robot is expected
+to be able to turn at the start and goal, which can use every sector
+whose slices they are clear in.
+
+Each slice has its own EdgeTable, and makeVisibility fills the usual
+nodes, isvisible and distanceCache, so findPath and the output methods
+work the same. A pair of nodes is tested against the two slices of its
+sector only when both nodes can use that sector, and when one end at
+least is the start, the goal, or a corner of one of those two slices. A
+path bends at a corner to get round that corner's obstacle, so at such
+an end the segment also has to pass the tangent test of the reduced
+graph, see makeVisibility. Pairs with neither end in the sector's slices
+are dropped: a path that turns at two corners of other slices in a row
+loses that segment, and bench slices finds paths within 0.1% of the
+ones over every pair.
+
+A graph with k slices still has about k + 2 times the nodes, and the
+matrix grows with the square of that, so slices don't cost a constant
+factor over one heading: bench slices plans about 20 times slower at
+k = 4 and 70 times slower at k = 8. Keep k small, or use one heading with
+a larger multiplier where the map allows it.
+
+Snapshots keep the slices, and inputHash takes the number of headings.
+
+*/
+
+void World::growSlices(int k, double mult)
+{
+  if (k < 1 || k > MAX_SLICES)
+    BARF("growSlices needs 1 to 32 headings");
+
+  _World_growShapes_keep(*this, 0, GrowParameters(GrowParameters::GROW_SLICES, mult, k));
+  gshapes.resize(0);
+  gvertices.resize(0);
+
+  int nr = DIM(robot) - 1;
+  WPoint reference = robot[nr];
+  vector<vector<Shape> > sshapes(k);
+  vector<vector<GVertex> > svertices(k);
+  vector<_World_growShapes_misses> misses(k);
+
+  WorkerPool::Task grow = [&](int s)
+  {
+    double heading = PI * s / k;
+    vector<WPoint> outline, corners;
+    for(int turn = 0; turn < 2; ++turn) // facing forwards and reversed
+    {
+      double c = cos(heading + turn * PI), si = sin(heading + turn * PI);
+      outline.resize(0);
+      for(int rv = 0; rv < nr; ++rv)
+      {
+        double x = robot[rv].x - reference.x, y = robot[rv].y - reference.y;
+        outline.push_back(reference + WPoint((coord)floor(c * x - si * y + 0.5), (coord)floor(si * x + c * y + 0.5)));
+      }
+      outline.push_back(reference);
+      _World_growShapes_outline(outline, mult, corners);
+    }
+    // the slices are spread over the workers already
+    _World_growShapes_grow(*this, corners, 0, sshapes[s], svertices[s], NULL, &misses[s]);
+  };
+
+  if (workers)
+    workers->run(k, grow);
+  else
+    for(int s = 0; s < k; ++s)
+      grow(s);
+
+  if (growCache)
+    for(int s = 0; s < k; ++s)
+      misses[s].store(*this, *growCache);
+
+  // one slice after another, with shape numbers and vertex indices into the whole arrays
+  for(int s = 0; s < k; ++s)
+  {
+    int shapeoffset = gshapes.size();
+    int vertexoffset = gvertices.size();
+    slices.push_back(Slice(PI * s / k, shapeoffset));
+    for(size_t i = 0; i < sshapes[s].size(); ++i)
+      gshapes.push_back(Shape(sshapes[s][i].startidx + vertexoffset, sshapes[s][i].vertices));
+    for(size_t i = 0; i < svertices[s].size(); ++i)
+    {
+      gvertices.push_back(svertices[s][i]);
+      gvertices.back().shapeno += shapeoffset;
+    }
+  }
+}
+
+/*! Local test for the reduced visibility graph
+
+   A shortest path only bends around the corners of obstacles, and where
+   it does, both of its segments touch the obstacle without entering it.
+   So an edge can only be on a shortest path if, at each end that is a
+   grown vertex, the vertices before and after it in its shape lie on
+   one side of the edge's line, or on it. Start and goal have no shape.
+   Most pairs fail the test at one end or the other, and are dropped
+   before their intersection test.
+
+   Vertices inside other shapes aren't nodes, and makeVisibility lets
+   the nodes on either side of them see each other as neighbours, so a
+   path can go straight between them. At those ends the edges are kept
+   as they are.
+*/
+class _World_makeVisibility_tangent
+{
+public:
+  typedef World::WPoint WPoint;
+  typedef World::Shape Shape;
+  typedef _Point_wide<World::coord>::type wide;
+
+  _World_makeVisibility_tangent(World const & world_)
+  : world(world_), isnode(world_.gvertices.size(), false)
+  {
+    for(int i = 0; i < world.nodes.size(); ++i)
+      if (world.nodes[i] >= 0)
+        isnode[world.nodes[i]] = true;
+  }
+
+  //! the segment from node p towards Q touches p's shape without entering it
+  bool operator()(int p, WPoint Q) const
+  {
+    int v = world.nodes[p];
+    if (v < 0)
+      return true;
+
+    Shape const & shape = world.gshapes[world.gvertices[v].shapeno];
+    int nv = shape.vertices;
+    if (nv < 3)
+      return true;
+
+    int i = v - shape.startidx;
+    int b0 = shape.startidx + (i + nv - 1) % nv, a0 = shape.startidx + (i + 1) % nv;
+    if (!isnode[b0] || !isnode[a0])
+      return true;
+
+    WPoint P = world.gvertices[v];
+    WPoint before = world.gvertices[b0];
+    WPoint after = world.gvertices[a0];
+    wide dx = (wide)Q.x - P.x, dy = (wide)Q.y - P.y;
+    wide b = _Point_cross(dx, dy, (wide)before.x - P.x, (wide)before.y - P.y);
+    wide a = _Point_cross(dx, dy, (wide)after.x - P.x, (wide)after.y - P.y);
+    return !(b < 0 && a > 0) && !(b > 0 && a < 0);
+  }
+
+private:
+  World const & world;
+  vector<bool> isnode;
+};
+
+/*! Planning over the slices from growSlices, see above */
+class _World_slices
+{
+public:
+  typedef World::WPoint WPoint;
+  typedef World::Shape Shape;
+  typedef World::GVertex GVertex;
+
+  _World_slices(World & world_)
+  : world(world_), k(world_.slices.size()), edges(k), vertexslice(world_.gvertices.size())
+  {
+    for(int s = 0; s < k; ++s)
+    {
+      int first = world.slices[s].firstshape;
+      int end = s + 1 < k ? world.slices[s + 1].firstshape : world.gshapes.size();
+      vector<Shape> shapes(world.gshapes.begin() + first, world.gshapes.begin() + end);
+      edges[s].assign(world.gvertices, shapes);
+      for(int i = first; i < end; ++i)
+        std::fill(vertexslice.begin() + world.gshapes[i].startidx,
+                  vertexslice.begin() + world.gshapes[i].startidx + world.gshapes[i].vertices, s);
+    }
+  }
+
+  //! fill world.nodes with the start, the grown vertices that can end a segment, and the goal
+  void makeNodes()
+  {
+    world.nodes.resize(0);
+    world.nodes.push_back(World::START);
+    for(size_t v = 0; v < world.gvertices.size(); ++v)
+      if (usable(arc(world.gvertices[v], vertexslice[v])))
+        world.nodes.push_back(v);
+    world.nodes.push_back(World::GOAL);
+    findSectors();
+  }
+
+  //! work out the sectors each node can use. call again after the start or goal move
+  void findSectors()
+  {
+    sectors.resize(world.nodes.size());
+    for(size_t p = 0; p < sectors.size(); ++p)
+    {
+      int v = world.nodes[p];
+      WPoint P = world.get_node(p);
+      if (v >= 0)
+        sectors[p] = usable(arc(P, vertexslice[v]));
+      else
+      {
+        unsigned free = 0;
+        for(int s = 0; s < k; ++s)
+          if (!edges[s].inside(P))
+            free |= bit(s);
+        sectors[p] = usable(free);
+      }
+    }
+  }
+
+  //! the robot can drive between nodes p and q, at P and Q. tangent tests the ends in the sector's slices
+  bool visible(int p, int q, WPoint P, WPoint Q, _World_makeVisibility_tangent const & tangent) const
+  {
+    if (P.equals(Q))
+      return false;
+
+    int s = sector(P, Q);
+    if (!(sectors[p] & sectors[q] & bit(s)))
+      return false;
+
+    int vp = world.nodes[p], vq = world.nodes[q];
+    int t = (s + 1) % k;
+    bool pends = ends(vp, s, t), qends = ends(vq, s, t);
+    if (!pends && !qends)
+      return false;
+    if ((pends && !tangent(p, Q)) || (qends && !tangent(q, P)))
+      return false;
+    return clear(s, vp, vq, P, Q) && (t == s || clear(t, vp, vq, P, Q));
+  }
+
+  //! fill row p of world.isvisible and world.distanceCache, after makeNodes
+  void row(int p, NodeTable const & table, _World_makeVisibility_tangent const & tangent)
+  {
+    WPoint P = table[p];
+    for(int q = 0; q <= p; ++q)
+    {
+      bool visible = p != q && this->visible(p, q, P, table[q], tangent);
+      world.isvisible(p,q) = visible;
+      if (visible)
+        world.distanceCache(p,q) = P.distanceTo(table[q]);
+    }
+  }
+
+private:
+  World & world;
+  int k;
+  vector<EdgeTable> edges;  // one per slice
+  vector<int> vertexslice;  // slice of every grown vertex
+  vector<unsigned> sectors; // bit s set if node p can end a segment in sector s
+
+  //! grown vertex v (or START or GOAL) can end a segment that is tested against slices s and t
+  bool ends(int v, int s, int t) const
+  {
+    return v < 0 || vertexslice[v] == s || vertexslice[v] == t;
+  }
+
+  unsigned bit(int s) const
+  {
+    return 1u << (s + k) % k;
+  }
+
+  //! slices around a, going both ways, where P is outside every obstacle. 0 if P is inside one in slice a
+  unsigned arc(WPoint P, int a) const
+  {
+    if (edges[a].inside(P))
+      return 0;
+    unsigned free = bit(a);
+    for(int d = 1; d < k && !edges[(a + d) % k].inside(P); ++d)
+      free |= bit(a + d);
+    for(int d = 1; d < k && !(free & bit(a - d)) && !edges[(a - d + k) % k].inside(P); ++d)
+      free |= bit(a - d);
+    return free;
+  }
+
+  //! sectors with both of their slices in free
+  unsigned usable(unsigned free) const
+  {
+    return free & ((free >> 1) | ((free & 1) << (k - 1)));
+  }
+
+  //! sector of the heading along PQ, either way
+  int sector(WPoint P, WPoint Q) const
+  {
+    // the outline faces +y, so a segment along +y needs no turn
+    double turn = fmod(atan2((double)Q.y - P.y, (double)Q.x - P.x) - PI / 2, PI);
+    if (turn < 0) turn += PI;
+    int s = (int)(turn * k / PI);
+    return s < k ? s : k - 1;
+  }
+
+  //! segment between grown vertices vp and vq (or START or GOAL) misses the obstacles of slice s
+  bool clear(int s, int vp, int vq, WPoint P, WPoint Q) const
+  {
+    if (vp >= 0 && vq >= 0 && world.gvertices[vp].shapeno == world.gvertices[vq].shapeno && vertexslice[vp] == s)
+    {
+      // grown vertices of the same shape only see their neighbours. the
+      // shape is only in its own slice, other slices test the segment
+      int nv = world.gshapes[world.gvertices[vp].shapeno].vertices;
+      int d = vp > vq ? vp - vq : vq - vp;
+      return d == 1 || d == nv - 1;
+    }
+    return !edges[s].intersects(P, Q);
+  }
+};
+
+
+int World::appendFile(char const * filename)
+{
+  int firstshape = shapes.size();
+  MappedFile file(filename);
+  _World_readFile_parser<Vertex> parser(vertices, &shapes, true);
+  parser.feed(file.begin(), file.end());
+  parser.finish();
+  return firstshape;
+}
+
+/*
+
+Obstacle files are split for parallel parsing right before the first
+number after a blank line (two newlines with no number between them).
+The scanner state there is known: nothing is pending, and as long as the
+first chunk had a vertex, the next newline closes whatever vertex follows.
+The only thing carried across is the y coordinate of a vertex that is
+missing one, which readFileParallel checks for.
+The chunk before the split ends on the line that number is on, so every
+chunk parses exactly as it would as part of the whole file, diagnostics
+included.
+
+*/
+
+//! first split point after p, or end if there isn't one
+char const * _World_readFile_split(char const * p, char const * end)
+{
+  // start at a line break so p can't be inside a number
+  p = (char const *)memchr(p, '\n', end - p);
+  if (!p) return end;
+
+  int newlines = 0;
+  for(; p != end; ++p)
+  {
+    char c = *p;
+    if (c == '\n')
+      ++newlines;
+    else if ((unsigned)((unsigned char)c - '0') < 10 || c == '-')
+    {
+      if (newlines >= 2) return p;
+      newlines = 0;
+    }
+  }
+  return end;
+}
+
+struct _World_readFile_chunk
+{
+  vector<World::Vertex> vertices;
+  vector<World::Shape> shapes;
+  vector<_World_readFile_diagnostic> diagnostics;
+  int lines;
+  bool inheritedY;
+};
+
+bool World::readFileParallel(MappedFile const & file, vector<Vertex> & vertices, vector<Shape> * shapes)
+{
+  typedef _World_readFile_chunk Chunk;
+
+  if (!shapes) return false;
+
+  // a few chunks per thread so uneven ones even out
+  char const * begin = file.begin();
+  char const * end = file.end();
+  size_t chunks = workers->size() * 4;
+
+  vector<char const *> splits(1, begin);
+  for(size_t k = 1; k < chunks; ++k)
+  {
+    char const * target = begin + file.size() / chunks * k;
+    char const * split = _World_readFile_split(std::max(target, splits.back()), end);
+    if (split == end) break;
+    splits.push_back(split);
+  }
+  splits.push_back(end);
+
+  int n = splits.size() - 1;
+  if (n < 2) return false;
+
+  vector<Chunk> parts(n);
+  workers->run(n, [&](int k)
+  {
+    Chunk & part = parts[k];
+    _World_readFile_parser<Vertex> parser(part.vertices, &part.shapes);
+    parser.keepDiagnostics(&part.diagnostics);
+    if (k > 0) parser.continueFile();
+    parser.feed(splits[k], splits[k+1]);
+    parser.finish();
+    part.lines = parser.lines();
+    part.inheritedY = parser.inheritedY();
+  });
+
+  // The later chunks were parsed assuming the first one had vertices, and
+  // a vertex missing its y coordinate at the start of a chunk should have
+  // kept the y from the chunk before. Leave malformed files like that to
+  // the serial parser.
+  if (parts[0].vertices.empty()) return false;
+  for(int k = 1; k < n; ++k)
+    if (parts[k].inheritedY) return false;
+
+  vector<int> vertexoffset(n + 1, 0);
+  vector<int> shapeoffset(n + 1, 0);
+  for(int k = 0; k < n; ++k)
+  {
+    vertexoffset[k+1] = vertexoffset[k] + parts[k].vertices.size();
+    shapeoffset[k+1] = shapeoffset[k] + parts[k].shapes.size();
+  }
+
+  vertices.resize(vertexoffset[n]);
+  shapes->resize(shapeoffset[n]);
+  workers->run(n, [&](int k)
+  {
+    Chunk const & part = parts[k];
+    for(size_t v = 0; v < part.vertices.size(); ++v)
+    {
+      Vertex & vertex = vertices[vertexoffset[k] + v];
+      vertex = part.vertices[v];
+      vertex.shapeno += shapeoffset[k];
+    }
+    for(size_t s = 0; s < part.shapes.size(); ++s)
+    {
+      Shape & shape = (*shapes)[shapeoffset[k] + s];
+      shape = part.shapes[s];
+      shape.startidx += vertexoffset[k];
+    }
+  });
 
-  // scratch variables
-  vector<GVertex> points;
-  vector<GVertex> hull;
-  
-  typedef vector<Shape>::const_iterator ishape;
-  typedef vector<WPoint>::const_iterator ipoint;
-  typedef vector<GVertex>::const_iterator ivertex;
-  typedef vector<GVertex>::const_iterator igvertex;
-  
-  vector<WPoint> mrobot;
-  for(int rv = 0; rv < DIM(robot); ++rv)
-    mrobot.push_back(WPoint(robot[rv].x * mult, robot[rv].y * mult));
+  int lineoffset = 0;
+  for(int k = 0; k < n; ++k)
+  {
+    for(size_t d = 0; d < parts[k].diagnostics.size(); ++d)
+      parts[k].diagnostics[d].print(lineoffset, vertexoffset[k]);
+    lineoffset += parts[k].lines;
+  }
+  return true;
+}
 
-  // rreference points to the robot's reference point
-  WPoint & rreference = mrobot.back();
+/*! Sweep and prune broad phase for noIntersect
 
-  // grow each shape   
-  for(ishape shape = shapes.begin(); shape != shapes.end(); ++shape) // for each shape
+   Sorts the shapes' bounding boxes by their left sides and sweeps across
+   them, keeping a list of the boxes that are still open. A new box is
+   checked against the open ones only, so edges are tested just for pairs
+   of shapes whose boxes overlap. Boxes that touch count as overlapping.
+*/
+class _World_noIntersect_sweep
+{
+public:
+  typedef World::coord coord;
+  typedef std::pair<int, int> Pair;
+
+  //! pairs (shape, earlier shape) whose boxes overlap, in the order noIntersect goes through them
+  static void candidates(vector<World::Shape> const & shapes, vector<World::GVertex> const & vertices, vector<Pair> & pairs)
   {
-    points.resize(0); // empty points array
-    
-    for(int v = shape->startidx; v < shape->startidx +shape->vertices; ++v) // for each vertex
+    vector<Box> boxes(shapes.size());
+    for(size_t s = 0; s < shapes.size(); ++s)
     {
-      // find the robot's reference positions when each of its vertices touches the obstacle vertex
-      // load these positions into the "points" array
-      for(int rv = 0; rv < mrobot.size()-1; ++rv) // for each robot vertex
+      Box & b = boxes[s];
+      b.shape = s;
+      b.xmin = b.xmax = vertices[shapes[s].startidx].x;
+      b.ymin = b.ymax = vertices[shapes[s].startidx].y;
+      for(int v = shapes[s].startidx + 1; v < shapes[s].startidx + shapes[s].vertices; ++v)
       {
-        GVertex p(vertices[v] + mrobot[rv] - rreference, shape-shapes.begin(), v);
-        points.push_back(p);
+        b.xmin = std::min(b.xmin, vertices[v].x);
+        b.xmax = std::max(b.xmax, vertices[v].x);
+        b.ymin = std::min(b.ymin, vertices[v].y);
+        b.ymax = std::max(b.ymax, vertices[v].y);
       }
     }
+    sort(boxes.begin(), boxes.end(), LeftLess());
 
-    // take the outermost shape made from these points
-    hull.resize(points.size());
-    vector<GVertex>::iterator hb = hull.begin(); // need a non constant iterator
-    igvertex hullend = convexHull(points.begin(), points.end(), hb);
-    
-    // store the results
-    nshapes.push_back(Shape(vertexno,hullend - hull.begin()));
-    for(igvertex i = hull.begin(); i != hullend; ++i)
+    pairs.resize(0);
+    vector<Box> open;
+    for(size_t i = 0; i < boxes.size(); ++i)
     {
-      nvertices.push_back(*i);
-      ++vertexno;
+      Box const & b = boxes[i];
+      for(size_t j = 0; j < open.size(); )
+      {
+        Box const & o = open[j];
+        if (o.xmax < b.xmin) // closed before b starts
+        {
+          open[j] = open.back();
+          open.pop_back();
+          continue;
+        }
+        if (o.ymin <= b.ymax && b.ymin <= o.ymax)
+          pairs.push_back(Pair(std::max(o.shape, b.shape), std::min(o.shape, b.shape)));
+        ++j;
+      }
+      open.push_back(b);
     }
+    sort(pairs.begin(), pairs.end());
   }
-  
-  /*
-  
-  don't use this after all...
-  
-  vector<Shape> *s1(&nshapes), *s2(&gshapes);
-  vector<GVertex> *v1(&nvertices), *v2(&gvertices);  
-  
-  while(noIntersect(*s1, *v1, *s2, *v2))
+
+private:
+  struct Box
   {
-    swap(s1,s2);
-    swap(v1,v2);
+    coord xmin, xmax, ymin, ymax;
+    int shape;
+  };
+
+  struct LeftLess
+  {
+    bool operator()(Box const & a, Box const & b) const
+    {
+      return a.xmin < b.xmin;
+    }
   };
-  
-  gshapes = *s1;
-  gvertices = *v1;
-  
-  */
-  
-  gshapes = nshapes;
-  gvertices = nvertices;
-  
 };
 
+/*! Groups of merged shapes for noIntersect
 
-class _World_noIntersect_lessthan // comparison functor, can't be declared locally with G++
+   A disjoint set forest over the shape numbers, with path compression.
+   The root of a group is always its highest shape number, which is the
+   number the old relabelling loop ended up giving the whole group, so
+   groups come out in the same order.
+*/
+class _World_noIntersect_groups
 {
 public:
-  bool operator()(World::GVertex a, World::GVertex b)
+  _World_noIntersect_groups(int shapes) : parent(shapes)
+  {
+    for(int s = 0; s < shapes; ++s)
+      parent[s] = s;
+  }
+
+  int find(int s)
   {
-    return a.shapeno < b.shapeno;
+    int root = s;
+    while (parent[root] != root)
+      root = parent[root];
+    while (parent[s] != root) // point everything on the way straight at the root
+    {
+      int next = parent[s];
+      parent[s] = root;
+      s = next;
+    }
+    return root;
+  }
+
+  //! put the group of earlier into the group of later, whose root must be later
+  void merge(int later, int earlier)
+  {
+    parent[find(earlier)] = later;
   }
+
+private:
+  vector<int> parent;
 };
 
 bool World::noIntersect
@@ -239,123 +1202,112 @@ bool World::noIntersect
   vector<Shape> & safter, vector<GVertex> & vafter
 )
 {
-  typedef _World_noIntersect_lessthan lessthan;
-  typedef vector<Shape>::const_iterator ishape;
-  typedef vector<WPoint>::const_iterator ipoint;
-  typedef vector<GVertex>::const_iterator ivertex;
   typedef vector<GVertex>::const_iterator igvertex;
   
   bool mergeany = false;  
 
-  // look for overlapping shapes, if two shapes overlap, they need to be merged
-  
-  // store the new vertex counts in an array
-  vector<int> vertexCount;
-  for(ishape shape1 = sbefore.begin(); shape1 != sbefore.end(); ++shape1) // for each shape, shape1
+  // look for overlapping shapes, if two shapes overlap, they need to be merged.
+  // a shape inside another counts as overlapping it. the shapes must be
+  // convex and counterclockwise, like growShapes makes them, and stored in
+  // order, with vertex shape numbers that are indices into sbefore
+  int nshapes = sbefore.size();
+  _World_noIntersect_groups groups(nshapes);
+
+  // only shapes with overlapping bounding boxes can intersect. the pairs
+  // come sorted, each shape with its earlier shapes in order
+  vector<_World_noIntersect_sweep::Pair> pairs;
+  _World_noIntersect_sweep::candidates(sbefore, vbefore, pairs);
+
+  for(size_t p = 0; p < pairs.size(); ++p) // for each shape1 and earlier shape2
   {
-    int sv1 = shape1->startidx; // start vertex
-    int nv1 = shape1->vertices; // number of vertices
-    int ev1 = sv1 + nv1;
+    int shape1 = pairs[p].first;
+    int shape2 = pairs[p].second;
 
-    vertexCount.push_back(nv1);
-    
-    for(ishape shape2 = sbefore.begin(); shape2 != shape1; ++shape2) // for each earlier shape, shape2
+    // already merged into shape1 through another shape. shape1 is still
+    // the root of its group, nothing later has been looked at yet
+    if (groups.find(shape2) == shape1)
+      continue;
+
+    Shape const & s1 = sbefore[shape1];
+    Shape const & s2 = sbefore[shape2];
+    bool overlap;
+    if (s1.vertices >= 3 && s2.vertices >= 3)
+      overlap = convexOverlap(&vbefore[s1.startidx], s1.vertices, &vbefore[s2.startidx], s2.vertices);
+    else // a grown shape flat enough to lose its area, only crossing edges count
     {
-      int sv2 = shape2->startidx; // start vertex
-      int nv2 = shape2->vertices; // number of vertices
-      int ev2 = sv2 + nv2;
-      
-      for(int e1 = sv1; e1 < ev1; ++e1) // for each edge of shape1
-      {
-        GVertex & P = vbefore[e1];
-        GVertex & Q = vbefore[(e1-sv1+1)%nv1 + sv1];
+      overlap = false;
+      for(int e1 = 0; e1 < s1.vertices && !overlap; ++e1)
+      for(int e2 = 0; e2 < s2.vertices && !overlap; ++e2)
+        overlap = linesIntersect<coord>(vbefore[s1.startidx + e1], vbefore[s1.startidx + (e1 + 1) % s1.vertices],
+                                        vbefore[s2.startidx + e2], vbefore[s2.startidx + (e2 + 1) % s2.vertices]);
+    }
 
-        for(int e2 = sv2; e2 < ev2; ++e2) // for each edge of shape2
-        {
-          GVertex & R = vbefore[e2];
-          GVertex & S = vbefore[(e2-sv2+1)%nv2 + sv2];
-          
-          if (linesIntersect(P,Q,R,S)) // if edges for these shapes intersect
-          {
-            mergeany = true;
-            int latershape = P.shapeno;
-            int earliershape = R.shapeno;
-            // subsume the earlier shape into the later one
-            vertexCount[latershape] += vertexCount[earliershape];
-            vertexCount[earliershape] = 0;
-            for(int v = 0; v < sv1; ++v) // subsume all vertexes which are part of this shape
-              if(vbefore[v].shapeno == earliershape)
-                vbefore[v].shapeno = latershape;
-            goto intersection_found;
-          }
-        }        
-      }
-      intersection_found:
-      continue; // examine the next shape2
-    } // for shape2
-  } // for shape1
+    if (overlap)
+    {
+      // subsume the earlier shape's group into the later one
+      mergeany = true;
+      groups.merge(shape1, shape2);
+    }
+  } // for each pair
   
   if (!mergeany) return false;
   
-  // sort vertices by shape number. ordering of vertices within each shape is preserved
-  stable_sort(vbefore.begin(),vbefore.end(),lessthan());
+  // bucket the shapes by group. each group keeps its shapes, and so its
+  // vertices, in their original order, and the groups go out in the
+  // order of their roots
+  vector<int> firstmember(nshapes, -1), lastmember(nshapes, -1), nextmember(nshapes, -1);
+  for(int s = 0; s < nshapes; ++s)
+  {
+    int root = groups.find(s);
+    if (firstmember[root] < 0)
+      firstmember[root] = s;
+    else
+      nextmember[lastmember[root]] = s;
+    lastmember[root] = s;
+  }
 
   // clear out the existing grown shape data
-  safter.resize(100);
   safter.resize(0);
-  vafter.resize(100);
   vafter.resize(0);
   
   // temporary place to store merged hulls
+  vector<GVertex> points;
   vector<GVertex> ghull;
+  vector<GVertex> hullscratch;
   
-  int lastshape = vbefore.front().shapeno;
   int shape = 0;
-  igvertex lastv = vbefore.begin();
-  for(igvertex v = vbefore.begin(); ; ++v) // for each vertex
+  for(int root = 0; root < nshapes; ++root)
   {
-    bool done = v == vbefore.end();
-    
-    if (done || v->shapeno != lastshape) // new shape
+    int first = firstmember[root];
+    if (first < 0) continue; // merged into a later shape
+
+    igvertex gvstart, gvend;
+    if (nextmember[first] >= 0) // shape is merged
     {
-      assert(v - lastv == vertexCount[lastshape]); // sanity check
+      points.resize(0);
+      for(int s = first; s >= 0; s = nextmember[s])
+        points.insert(points.end(), vbefore.begin() + sbefore[s].startidx, vbefore.begin() + sbefore[s].startidx + sbefore[s].vertices);
 
-      igvertex gvstart, gvend;
-      vector<GVertex>::iterator hullstart, hullend;
-      
-      if (vertexCount[lastshape] > sbefore[lastshape].vertices) // shape is merged
-      {
-        ghull.resize(v - lastv);
-        hullstart = ghull.begin();
-        hullend = convexHull(lastv, v, hullstart);
-        gvstart = hullstart;
-        gvend = hullend;
-      }
-      else if(vertexCount[lastshape] == sbefore[lastshape].vertices) // shape is unchanged
-      {
-        gvstart = lastv;
-        gvend = v;
-      }
-      else
-      {
-        assert(false);
-      }
+      ghull.resize(points.size());
+      vector<GVertex>::iterator hullstart = ghull.begin();
+      gvstart = hullstart;
+      gvend = convexHull(points.begin(), points.end(), hullstart, hullscratch);
+    }
+    else // shape is unchanged
+    {
+      gvstart = vbefore.begin() + sbefore[root].startidx;
+      gvend = gvstart + sbefore[root].vertices;
+    }
 
-      // add the shape and copy the vertices (from either a hull or the existing vertex array)
-      safter.push_back(Shape(vafter.size(),gvend - gvstart));
-      for(igvertex i = gvstart; i != gvend; ++i)
-      {
-        vafter.push_back(*i);
-        vafter.back().shapeno = shape;
-      }
-      
-      ++shape;
-      lastv = v;
+    // add the shape and copy the vertices (from either a hull or the existing vertex array)
+    safter.push_back(Shape(vafter.size(),gvend - gvstart));
+    for(igvertex i = gvstart; i != gvend; ++i)
+    {
+      vafter.push_back(*i);
+      vafter.back().shapeno = shape;
     }
     
-    if (done) break;
-    
-    lastshape = v->shapeno;
+    ++shape;
   }
   return true;
 };
@@ -371,10 +1323,48 @@ World::GVertex const & World::get_node(int i)
     return gvertices[n];
 };
 
+/*
+
+Building the visibility graph on the workers
+
+Row p of the matrix holds the p + 1 pairs (p, q <= p), so equal numbers
+of rows would leave the thread with the last rows doing most of the
+work. makeVisibility cuts the rows into runs of consecutive rows that
+cost about the same, p + 1 pair tests a row, or one whole sweep a row
+with the sweep, eight runs per thread. The pool hands the runs out one
+at a time, so a thread that finishes early takes the next run, and runs
+that take longer than planned (rows of a crowded part of the map) even
+out.
+
+Each run writes only its own rows of isvisible and distanceCache, which
+are packed one row after another, so the threads need no locks and
+share a cache line only where two runs meet. The edge table, node table
+and tangent test are only read. The sweep keeps its state in the
+object, so every run sweeps with its own copy.
+
+A sliced world's rows are split into the same runs. The runs share one
+_World_slices, whose edge tables, vertex slices and sector masks don't
+change once makeNodes has filled them.
+
+*/
+//! first row of each run and gpl after the last. a row costs p + 1 pair tests, or gpl with the sweep
+static vector<int> _World_makeVisibility_runs(int gpl, int runs, bool swept)
+{
+  vector<int> firstrow(runs + 1, gpl);
+  firstrow[0] = 0;
+  double total = swept ? (double)gpl * gpl : (double)gpl * (gpl + 1) / 2, cost = 0;
+  for(int p = 0, r = 1; p < gpl && r < runs; ++p)
+  {
+    cost += swept ? gpl : p + 1;
+    while (r < runs && cost >= total * r / runs)
+      firstrow[r++] = p + 1;
+  }
+  return firstrow;
+}
+
 void World::makeVisibility()
 {
   typedef vector<GVertex>::const_iterator ivertex;
-  typedef vector<Shape>::const_iterator ishape;
   typedef vector<WPoint>::const_iterator ipoint;
   
   // find center start and goal points
@@ -387,6 +1377,36 @@ void World::makeVisibility()
   goal = goal / (goalarea.end() - goalarea.begin());
 
 
+  if (!slices.empty())
+  {
+    _World_slices sliced(*this);
+    sliced.makeNodes();
+
+    int gpl = nodes.size();
+    isvisible.resize(gpl);
+    distanceCache.resize(gpl);
+
+    NodeTable table;
+    table.assign(*this);
+    _World_makeVisibility_tangent tangent(*this);
+
+    // the rows share the slices, which they only read
+    int runs = workers && gpl >= PARALLEL_VISIBILITY_NODES ? workers->size() * 8 : 1;
+    vector<int> firstrow = _World_makeVisibility_runs(gpl, runs, false);
+
+    WorkerPool::Task build = [&](int r)
+    {
+      for(int p = firstrow[r]; p < firstrow[r + 1]; ++p)
+        sliced.row(p, table, tangent);
+    };
+
+    if (runs > 1)
+      workers->run(runs, build);
+    else
+      build(0);
+    return;
+  }
+
   // fill up nodes array, include start and goal points,
   // exclude any points that are inside obstacles
   nodes.resize(0);
@@ -395,39 +1415,15 @@ void World::makeVisibility()
   vector<GVertex> const & vertices = this->gvertices;
   vector<Shape> const & shapes = this->gshapes;
 
-  for(ivertex v = vertices.begin(); v != vertices.end(); ++v)
-  {
-    bool reject = false;
-    for(ishape shape = shapes.begin(); shape != shapes.end(); ++shape)
-    {
-      int sv = shape->startidx; // start vertex
-      int nv = shape->vertices; // number of vertices
-      int ev = sv + nv;
-      bool inside = true;
-      for(int e = sv; e < ev; ++e) // for each edge of shape1
-      {
-        GVertex const & P = vertices[e];
-        GVertex const & Q = vertices[(e-sv+1)%nv + sv];
+  EdgeTable edges;
+  edges.assign(vertices, shapes);
 
-        // assumes we are traversing the vertices of the polygon in
-        // ccw order (as outputted by the convex hull algorithm)
-        if (v->line_rside(P, Q) != WPoint::LEFT_SIDE)
-        {
-          inside = false;
-          break;
-        }
-      };
-      if (inside)
-      {
-        reject = true;
-        break;
-      }
-    }
-    if (!reject)
-    {
+  // assumes the vertices of the polygons are in
+  // ccw order (as outputted by the convex hull algorithm)
+  for(ivertex v = vertices.begin(); v != vertices.end(); ++v)
+    if (!edges.inside(*v))
       nodes.push_back(v - vertices.begin());
-    }
-  }  
+
   nodes.push_back(GOAL);
 
   int gpl = nodes.size();
@@ -435,49 +1431,68 @@ void World::makeVisibility()
   isvisible.resize(gpl);
   distanceCache.resize(gpl);
 
-  for(int p = 0; p < gpl; ++p) // try each potential visiblity graph edge
-  for(int q = 0; q <= p; ++q)
-  {
-    GVertex const & P = get_node(p);
-    GVertex const & Q = get_node(q);
+  NodeTable table;
+  table.assign(*this);
 
-    bool visible = true;
+  RotationalSweep sweep;
+  bool swept = visibilityEngine == VISIBILITY_SWEEP && sweep.assign(*this, table, edges);
 
-    if (P.shapeno == Q.shapeno)
-    {
-      if(P.shapeno >= 0)
-      {
-        int nv = shapes[P.shapeno].vertices;
-        visible = (p - q == 1 || p - q == nv - 1);
-      }
-      else
-        visible = false;
-    }
-    else
+  EdgeGrid grid;
+  bool gridded = visibilityEngine == VISIBILITY_GRID;
+  if (gridded)
+    grid.assign(vertices, shapes);
+
+  _World_makeVisibility_tangent tangent(*this);
+
+  // split the rows into runs of about the same cost, see above
+  int runs = workers && gpl >= PARALLEL_VISIBILITY_NODES ? workers->size() * 8 : 1;
+  vector<int> firstrow = _World_makeVisibility_runs(gpl, runs, swept);
+
+  WorkerPool::Task build = [&](int r)
+  {
+    RotationalSweep rowsweep(sweep);
+    vector<char> row;
+    EdgeGrid::Visits visits;
+
+    for(int p = firstrow[r]; p < firstrow[r + 1]; ++p) // try each potential visiblity graph edge
     {
-      for(ishape shape = shapes.begin(); shape != shapes.end(); ++shape) 
+      if (swept)
+        rowsweep.from(p, row);
+
+      for(int q = 0; q <= p; ++q)
       {
-        int sv = shape->startidx;   // start vertex
-        int nv = shape->vertices;    // number of vertices
-        int ev = sv + nv;
+        WPoint P = table[p];
+        WPoint Q = table[q];
+        int shapeno = table.shapeno[p];
 
-        for(int e = sv; e < ev; ++e) // for each edge of shape
+        bool visible = true;
+
+        if (shapeno == table.shapeno[q])
         {
-          GVertex const & R = vertices[e];
-          GVertex const & S = vertices[(e-sv+1)%nv + sv];
-          if (linesIntersect(P,Q,R,S))
+          if(shapeno >= 0)
           {
-            visible = false;
-            goto skip;
+            int nv = shapes[shapeno].vertices;
+            visible = (p - q == 1 || p - q == nv - 1);
           }
-        }        
+          else
+            visible = false;
+        }
+        else if (bitangentsOnly && !(tangent(p, Q) && tangent(q, P)))
+          visible = false;
+        else
+          visible = swept ? row[q] : gridded ? !grid.intersects(P, Q, visits) : !edges.intersects(P,Q);
+
+        isvisible(p,q) = visible;
+        if (visible)
+          distanceCache(p,q) = visible ? P.distanceTo(Q) : DBL_MAX;
       }
     }
-    skip:
-    isvisible(p,q) = visible;
-    if (visible)
-      distanceCache(p,q) = visible ? P.distanceTo(Q) : DBL_MAX;
-  }
+  };
+
+  if (runs > 1)
+    workers->run(runs, build);
+  else
+    build(0);
 }  
 
 
@@ -518,12 +1533,64 @@ public:
   }
 };
 
+// visibility graph as adjacency lists, so the search walks contiguous arrays
+// of real edges instead of a whole row of the matrix for every node
+struct _World_findPath_graph
+{
+  //! neighbors of node v are to[first[v]] through to[first[v+1]-1], in increasing order
+  vector<int> first;
+  vector<int> to;
+  vector<double> length;
+
+  _World_findPath_graph(SMatrix<bool> const & isvisible, SMatrix<double> const & distance, int n)
+  : first(n + 1, 0)
+  {
+    // count the neighbors of each node, without branches so it vectorizes
+    bool const * visible = isvisible.raw();
+    for(int p = 0; p < n; ++p)
+    {
+      bool const * row = visible + (size_t)p * (p + 1) / 2;
+      int count = row[p];
+      for(int q = 0; q < p; ++q)
+      {
+        count += row[q];
+        first[q + 1] += row[q];
+      }
+      first[p + 1] += count;
+    }
+
+    for(int v = 0; v < n; ++v)
+      first[v + 1] += first[v];
+
+    to.resize(first[n]);
+    length.resize(first[n]);
+    vector<int> next(first.begin(), first.end() - 1);
+
+    // rows of the packed matrix are visited in order, so every list fills up sorted
+    double const * d = distance.raw();
+    size_t i = 0;
+    for(int p = 0; p < n; ++p)
+    for(int q = 0; q <= p; ++q, ++i)
+    if (visible[i])
+    {
+      to[next[p]] = q;
+      length[next[p]++] = d[i];
+      if (q != p)
+      {
+        to[next[q]] = p;
+        length[next[q]++] = d[i];
+      }
+    }
+  }
+};
+
 void World::findPath()
 {
   typedef _World_findPath_pcompare pcompare;
   typedef _World_findPath_IntDist IntDist;
   typedef vector<int>::iterator vi;
   typedef _World_findPath_updatepos updatepos;
+  _World_findPath_graph graph(isvisible, distanceCache, nodes.size());
   vector<IntDist> d(nodes.size());
   d[0].d = 0; // start node;
 
@@ -543,11 +1610,10 @@ void World::findPath()
     
     IntDist & V = d[v];
 
-    for(int w = 0; w < nodes.size(); ++w)
-    if (isvisible(v,w))
+    for(int e = graph.first[v]; e < graph.first[v + 1]; ++e)
     {
-      IntDist & W = d[w];
-      double Wdistance = V.d + distanceCache(v,w);
+      IntDist & W = d[graph.to[e]];
+      double Wdistance = V.d + graph.length[e];
       if (Wdistance < W.d)
       {
         W.d = Wdistance;
@@ -568,38 +1634,126 @@ void World::findPath()
   }
 }
 
+/*
+
+Margin sweep
+
+The planner is run once per margin on a world of its own, which gets a
+copy of the parsed obstacles, so the margins can run on the workers at
+the same time. Each one grows, builds its visibility graph and finds its
+path on a single thread, the workers are busy with the other margins.
+The grow cache isn't shared, the margins would add to it at once.
+
+*/
+
+void World::sweepMargins(double first, double last, int steps, bool fast, vector<MarginResult> & results)
+{
+  if (steps < 1)
+    BARF("sweepMargins needs at least one margin");
+  if (startarea.empty() || goalarea.empty())
+    BARF("sweepMargins needs a start and a goal");
+
+  results.resize(steps);
+  WorkerPool::Task plan = [&](int i)
+  {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    MarginResult & r = results[i];
+    r.margin = steps > 1 ? first + (last - first) * i / (steps - 1) : first;
+
+    World world;
+    world.shapes = shapes;
+    world.vertices = vertices;
+    world.startarea = startarea;
+    world.goalarea = goalarea;
+    world.growEngine = growEngine;
+    world.visibilityEngine = visibilityEngine;
+    world.bitangentsOnly = bitangentsOnly;
+    world.mergeOverlaps = mergeOverlaps;
+
+    if (fast)
+      world.fgrowShapes(r.margin);
+    else
+      world.growShapes(r.margin);
+    world.makeVisibility();
+    world.findPath();
+
+    // the path runs back from the goal, and reaches the start node only if there is one
+    r.found = world.path.size() > 1 && world.path.back() == 0;
+    r.length = 0;
+    if (r.found)
+      for(size_t p = 1; p < world.path.size(); ++p)
+        r.length += world.get_node(world.path[p]).distanceTo(world.get_node(world.path[p - 1]));
+
+    r.nodes = world.nodes.size();
+    r.edges = 0;
+    for(int p = 0; p < r.nodes; ++p)
+      for(int q = 0; q < p; ++q)
+        r.edges += world.isvisible(p, q);
+
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  };
+
+  if (workers)
+    workers->run(steps, plan);
+  else
+    for(int i = 0; i < steps; ++i)
+      plan(i);
+}
+
+void World::outputMargins(FILE * fp, vector<MarginResult> const & results)
+{
+  fprintf(fp, "margin\tpath\tlength\tnodes\tedges\tms\n");
+  for(size_t i = 0; i < results.size(); ++i)
+  {
+    MarginResult const & r = results[i];
+    fprintf(fp, "%g\t%s\t%.1f\t%d\t%ld\t%.3f\n", r.margin, r.found ? "yes" : "no", r.length, r.nodes, r.edges, r.seconds * 1e3);
+  }
+}
+
 void World::reorient()
 {
-  typedef vector<Shape>::const_iterator ishape;
   vector<GVertex> const & vertices = this->gvertices;
   vector<Shape> const & shapes = this->gshapes;
-  
-  int p = 0;
-  for(int q = 1; q < nodes.size(); ++q)
-  {
-    GVertex const & P = get_node(p);
-    GVertex const & Q = get_node(q);
 
-    bool visible = true;
+  if (!slices.empty())
+  {
+    _World_slices sliced(*this);
+    sliced.findSectors();
 
-    for(ishape shape = shapes.begin(); shape != shapes.end(); ++shape) 
+    NodeTable table;
+    table.assign(*this);
+    _World_makeVisibility_tangent tangent(*this);
+    for(int q = 1; q < table.size(); ++q)
     {
-      int sv = shape->startidx;   // start vertex
-      int nv = shape->vertices;    // number of vertices
-      int ev = sv + nv;
-
-      for(int e = sv; e < ev; ++e) // for each edge of shape
-      {
-        GVertex const & R = vertices[e];
-        GVertex const & S = vertices[(e-sv+1)%nv + sv];
-        if (linesIntersect(P,Q,R,S))
-        {
-          visible = false;
-          goto skip;
-        }
-      }        
+      bool visible = sliced.visible(0, q, table[0], table[q], tangent);
+      isvisible(0,q) = visible;
+      if (visible)
+        distanceCache(0,q) = table[0].distanceTo(table[q]);
     }
-    skip:
+    return;
+  }
+  
+  EdgeTable edges;
+  edges.assign(vertices, shapes);
+
+  NodeTable table;
+  table.assign(*this);
+
+  EdgeGrid grid;
+  EdgeGrid::Visits visits;
+  bool gridded = visibilityEngine == VISIBILITY_GRID;
+  if (gridded)
+    grid.assign(vertices, shapes);
+
+  _World_makeVisibility_tangent tangent(*this);
+
+  int p = 0;
+  WPoint P = table[p];
+  for(int q = 1; q < table.size(); ++q)
+  {
+    WPoint Q = table[q];
+
+    bool visible = (!bitangentsOnly || tangent(q, P)) && !(gridded ? grid.intersects(P, Q, visits) : edges.intersects(P,Q));
     isvisible(p,q) = visible;
     if (visible)
       distanceCache(p,q) = visible ? P.distanceTo(Q) : DBL_MAX;
@@ -623,54 +1777,106 @@ void World::reorient(WPoint newobstacle, coord radius)
 
 void World::outputVisibility(FILE * fp)
 {
+  BufferedWriter out(fp);
   for(int i = 0; i < isvisible.size(); ++i)
+  {
+    GVertex const & I = get_node(i);
+    for(int j = 0; j < i; ++j)
+    {
+      if (isvisible(i,j))
+      {
+        GVertex const & J = get_node(j);
+        out << I.x << ' ' << I.y << " # shape " << I.shapeno << ", vertex " << nodes[i] << '\n';
+        out << J.x << ' ' << J.y << " # shape " << J.shapeno << ", vertex " << nodes[j] << "\n\n";
+      }
+    }
+  }
+  out.flush();
+}
+
+/*
+
+Binary visibility graph layout, all fields 32 bit in native byte order
+
+  "QMVG"
+  node count, edge count
+  for each node:  x, y, shapeno, gvertices index (or START / GOAL)
+  for each edge:  node index i, node index j, with j < i
+
+*/
+
+void World::outputVisibilityBinary(FILE * fp)
+{
+  int32_t n = isvisible.size();
+  int32_t edges = 0;
+  for(int i = 0; i < n; ++i)
+  for(int j = 0; j < i; ++j)
+    if (isvisible(i,j)) ++edges;
+
+  BufferedWriter out(fp);
+  out.write("QMVG", 4);
+
+  int32_t counts[] = { n, edges };
+  out.write(counts, sizeof(counts));
+
+  for(int i = 0; i < n; ++i)
+  {
+    GVertex const & I = get_node(i);
+    int32_t node[] = { I.x, I.y, I.shapeno, nodes[i] };
+    out.write(node, sizeof(node));
+  }
+
+  for(int i = 0; i < n; ++i)
   for(int j = 0; j < i; ++j)
   {
     if (isvisible(i,j))
     {
-      GVertex I = get_node(i);
-      GVertex J = get_node(j);
-      fprintf(fp, "%i %i # shape %i, vertex %i\n"  , I.x, I.y, I.shapeno, nodes[i]);
-      fprintf(fp, "%i %i # shape %i, vertex %i\n\n", J.x, J.y, J.shapeno, nodes[j]);
+      int32_t edge[] = { i, j };
+      out.write(edge, sizeof(edge));
     }
   }
+  out.flush();
 }
 
 void World::outputPath(FILE * fp)
 {
+  BufferedWriter out(fp);
   for(vector<int>::const_iterator p = path.begin(); p != path.end(); ++p)
   {
-    GVertex g = get_node(*p);
-    fprintf(fp, "%i %i\n",g.x,g.y);
+    GVertex const & g = get_node(*p);
+    out << g.x << ' ' << g.y << '\n';
   }
-  fprintf(fp, "\n");
+  out << '\n';
+  out.flush();
 }
 
 void World::outputTargets(FILE * fp)
 {
   typedef vector<WPoint>::const_iterator ivertex;
   
+  BufferedWriter out(fp);
   for(ivertex i = goalarea.begin(); ; ++i)
   {
     if (i == goalarea.end())
     {
-      fprintf(fp, "%i %i\n\n",goalarea[0].x,goalarea[0].y);
+      out << goalarea[0].x << ' ' << goalarea[0].y << "\n\n";
       break;
     }
     else
-      fprintf(fp, "%i %i\n",i->x,i->y);
+      out << i->x << ' ' << i->y << '\n';
   }
   
   for(ivertex i = startarea.begin(); ; ++i)
   {
     if (i == startarea.end())
     {
-      fprintf(fp, "%i %i\n\n",startarea[0].x,startarea[0].y);
+      out << startarea[0].x << ' ' << startarea[0].y << "\n\n";
       break;
     }
     else
-      fprintf(fp, "%i %i\n",i->x,i->y);
+      out << i->x << ' ' << i->y << '\n';
   }
+  out.flush();
 };
 
 
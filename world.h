@@ -4,6 +4,10 @@
 #include <stdio.h>
 #include "point.h"
 #include "smatrix.h"
+#include "footprint.h"
+
+class WorkerPool;
+class GrowCache;
 
 class World
 {
@@ -54,6 +58,21 @@ public:
     : Vertex(wpoint,shapeno), vertexno(vertexno_) {}
   };
   
+  //! obstacles grown for one robot heading, see growSlices
+  struct Slice
+  {
+    //! radians the robot is turned counterclockwise from its outline in robot
+    double heading;
+
+    //! the slice's grown shapes run from gshapes[firstshape] to the next slice's first shape
+    int firstshape;
+
+    Slice(double heading_ = 0, int firstshape_ = 0)
+    : heading(heading_), firstshape(firstshape_) { }
+  };
+
+  World() : workers(NULL), growCache(NULL), growEngine(GROW_MINKOWSKI), visibilityEngine(VISIBILITY_PAIRS), bitangentsOnly(false), mergeOverlaps(false) { }
+
   //! array of shapes
   vector<Shape> shapes;
 
@@ -83,14 +102,102 @@ public:
   //! optimal path of grown vertices, comprised of indices into the gvertices array
   vector<int> path;
 
-  // robot dimensions and reference point
-  static WPoint robot[];
+  // robot dimensions and reference point, the Pioneer outline unless changed
+  static WPoint robot[PioneerFootprint::CORNERS + 1];
+
+  //! threads for the parallel versions of the methods below, NULL to run everything on the calling thread
+  WorkerPool * workers;
+
+  //! grown obstacles from earlier runs for growShapes, growSlices and fgrowShapes, NULL to grow every one
+  GrowCache * growCache;
+
+  //! obstacle files at least this large are parsed in parallel when workers are set
+  enum { PARALLEL_PARSE_SIZE = 1 << 22 };
+
+  //! growShapes and fgrowShapes split the shapes over the workers when there are at least this many to grow
+  enum { PARALLEL_GROW_SHAPES = 256 };
+
+  //! makeVisibility splits the rows of the visibility matrix over the workers from this many nodes on
+  enum { PARALLEL_VISIBILITY_NODES = 256 };
+
+  //! ways for growShapes to build the grown obstacles. they give the same shapes
+  enum GrowEngine
+  {
+    GROW_HULL,      //!< convex hull of every obstacle vertex plus every robot corner
+    GROW_MINKOWSKI  //!< edge merge of the obstacle's hull with the robot, O(n+m) per shape
+  };
+
+  //! engine used by growShapes
+  GrowEngine growEngine;
+
+  //! ways for makeVisibility to find which nodes see each other. they give the same graph
+  enum VisibilityEngine
+  {
+    VISIBILITY_PAIRS, //!< every pair of nodes against the edge table
+    VISIBILITY_SWEEP, //!< rotational sweep around each node, see rotsweep.h. pairs if coordinates are too large
+    VISIBILITY_GRID   //!< every pair of nodes against a uniform grid of the edges, see edgegrid.h
+  };
+
+  //! engine used by makeVisibility, and by reorient for the grid. slices always test pairs
+  VisibilityEngine visibilityEngine;
+
+  //! makeVisibility and reorient keep only edges that are tangent to the grown obstacle at each
+  //! end, the only ones a shortest path can use. findPath finds the same path over far fewer edges.
+  //! slices always test the ends in their sector's slices, see growSlices
+  bool bitangentsOnly;
+
+  //! merge grown shapes that overlap with noIntersect. growShapes then always regrows every shape
+  bool mergeOverlaps;
+
+  //! a grow method and its amount, so that growing and the snapshot input hash can't disagree
+  struct GrowParameters
+  {
+    enum Method
+    {
+      NONE,         //!< grown some other way, or not at all. inputHash can't describe it
+      GROW_SHAPES,  //!< growShapes(amount)
+      FGROW_SHAPES, //!< fgrowShapes(amount)
+      GROW_SLICES   //!< growSlices(slices, amount)
+    };
+
+    Method method;
+    double amount;
+    int slices;
+
+    GrowParameters(Method method_ = NONE, double amount_ = 0, int slices_ = 0)
+    : method(method_), amount(amount_), slices(slices_) { }
+
+    bool operator==(GrowParameters const & other) const
+    {
+      return method == other.method && amount == other.amount && slices == other.slices;
+    }
+  };
+
+  //! how the grown shapes were made. growShapes(m), fgrowShapes and growSlices set it, when shapes
+  //! kept from an earlier call were grown the same way, and the other grow methods clear it
+  GrowParameters grownWith;
+
+  //! grow obstacles with the method and amount in parameters
+  void grow(GrowParameters const & parameters);
 
   //! grow obstacles using method described in hw. m is a multipler for the size of the robot
-  void growShapes(double m);
+  //! shapes before firstshape are assumed to be grown already and are kept
+  void growShapes(double m, int firstshape = 0);
+
+  //! same with any robot outline, laid out like robot: the corners, then the reference point
+  void growShapes(vector<WPoint> const & outline, double m, int firstshape = 0);
+
+  //! headings grown by growSlices, empty when the obstacles are grown for a single heading
+  vector<Slice> slices;
+
+  enum { MAX_SLICES = 32 };
+
+  //! grow obstacles for k robot headings spread over half a turn, in parallel on the workers.
+  //! the slices go into gshapes one after another, and makeVisibility and reorient plan with them
+  void growSlices(int k, double m);
 
   //! grow obstacles with a faster & simpler algorithm
-  void fgrowShapes(double amount);
+  void fgrowShapes(double amount, int firstshape = 0);
 
   // generate visibility graph
   void makeVisibility();
@@ -98,18 +205,70 @@ public:
   //! find the optimal path through the obstacles  
   void findPath();
 
+  //! what planning with one growShapes multiplier or fgrowShapes amount gave, see sweepMargins
+  struct MarginResult
+  {
+    double margin;
+    bool found;      //!< false if there is no path to the goal
+    double length;   //!< path length, 0 without a path
+    int nodes;       //!< visibility graph nodes
+    long edges;      //!< visibility graph edges
+    double seconds;  //!< growing, makeVisibility and findPath
+  };
+
+  //! grow, makeVisibility and findPath for steps margins spread evenly from first to last, at the same
+  //! time on the workers. margins are growShapes multipliers, or fgrowShapes amounts if fast.
+  //! every margin starts from this world's obstacles, start and goal, and this world is left alone
+  void sweepMargins(double first, double last, int steps, bool fast, vector<MarginResult> & results);
+
+  //! table of sweepMargins results, one margin per line
+  static void outputMargins(FILE * fp, vector<MarginResult> const & results);
+
   //! Read obstacle file
   template<typename PointType>
   void readFile(FILE * fp, vector<PointType> & vertices, vector<Shape> * shapes = NULL);
 
+  //! Read obstacle file by name, scanning it in place through a memory mapping
+  template<typename PointType>
+  void readFile(char const * filename, vector<PointType> & vertices, vector<Shape> * shapes = NULL);
+
+  //! Parse a mapped obstacle file in chunks on the workers. false if it can't be split
+  bool readFileParallel(MappedFile const & file, vector<Vertex> & vertices, vector<Shape> * shapes);
+
+  template<typename PointType>
+  bool readFileParallel(MappedFile const & file, vector<PointType> & vertices, vector<Shape> * shapes)
+  {
+    return false; // only obstacle vertices are read in parallel
+  }
+
+  //! Read another obstacle file on top of the existing obstacles. Returns the index of its first new shape
+  int appendFile(char const * filename);
+
+  //! Read a saphira world file (.wld) into shapes and vertices, replacing the obstacles
+  void readWorldFile(char const * filename);
+
   template<class InputIterator>
   void outputShapes(FILE * fp, InputIterator istart, InputIterator iend);
 
   void outputTargets(FILE * fp);
   void outputVisibility(FILE * fp);
+
+  //! visibility graph as a compact binary edge list, see world.cpp for the layout
+  void outputVisibilityBinary(FILE * fp);
   void outputPath(FILE * fp);
   void describe(bool show_vertices, bool show_gvertices, bool show_nodes, bool show_visibility);
 
+  //! hash of the obstacles, start and goal areas, robot, the grow method and its parameters, and
+  //! the flags that change the grown shapes or the graph (mergeOverlaps, bitangentsOnly)
+  uint64_t inputHash(GrowParameters const & parameters);
+
+  //! write grown shapes, visibility graph and path to a binary snapshot file. BARFs if hash
+  //! isn't inputHash(grownWith), so a snapshot can't be saved under the hash of other inputs
+  void saveSnapshot(char const * filename, uint64_t hash);
+
+  //! restore a snapshot written with the same input hash. returns false, leaving the world alone, if there isn't one
+  bool loadSnapshot(char const * filename, uint64_t hash);
+
   //! update visibility and distance tables with for starting position. findpath() should be called next
   void reorient();
 
@@ -195,97 +354,261 @@ using std::cerr;
 using std::endl;
 
 
-template<typename PointType>
-void World::readFile(FILE * fp, vector<PointType> & vertices, vector<Shape> * shapes)
+//! A problem found while reading an obstacle file
+struct _World_readFile_diagnostic
 {
-  // clear out existing data
-  if (shapes) shapes->resize(0);
-  vertices.resize(0);
+  int lineno;
+  int vertexno; //!< vertex with bad coordinates, or -1 for cruft
+  string cruft;
 
-  // state variables
-  int shapeno = 0;
-  int vertexno = 0;
-  int lastvertexno = 0;
-  Vertex vertex(0,0,shapeno);
+  _World_readFile_diagnostic(int lineno_, int vertexno_, string const & cruft_ = string())
+  : lineno(lineno_), vertexno(vertexno_), cruft(cruft_) { }
 
-  enum { XCOORD, YCOORD, CRUFT };
-  int state = XCOORD;
+  //! offsets turn numbers counted from the start of a chunk into file numbers
+  void print(int lineoffset = 0, int vertexoffset = 0) const
+  {
+    if (vertexno < 0)
+      cerr << "Cruft '" << cruft << "' found on line " << lineno + lineoffset << "." << endl;
+    else
+      cerr << "Parse error on line " << lineno + lineoffset << ". Vertex " << vertexno + vertexoffset << " has invalid x or y coordinates" << endl;
+  }
+};
 
-  int newlines(0);
-  int lineno = 1;
-  string num = "";
+/*! Scanner for the obstacle file format, shared by both readFile methods
 
-  const size_t BUFFERSIZE = 4096;
-  size_t buffer_size;
-  char buffer[BUFFERSIZE];
-  for(;;)
+   Coordinates are whitespace separated integers, one vertex per line.
+   A blank line ends a shape, and a closing vertex that repeats the
+   first vertex of its shape is dropped. Input arrives in blocks through
+   feed(), and a number may be split across two blocks.
+
+   In append mode the new vertices and shapes go after the existing ones,
+   numbered to follow them.
+
+   Problems are reported on cerr as they are found, or saved with
+   keepDiagnostics() when the input is a chunk of a larger file.
+*/
+template<typename PointType>
+class _World_readFile_parser
+{
+public:
+  typedef World::Vertex Vertex;
+  typedef World::Shape Shape;
+
+  _World_readFile_parser(vector<PointType> & vertices_, vector<Shape> * shapes_, bool append = false)
+  : vertices(vertices_), shapes(shapes_), state(XCOORD), newlines(0), lineno(1),
+    intoken(false), diagnostics(NULL), midfile(false), yread(false), yinherited(false)
   {
-    buffer_size = fread(buffer,sizeof(char), BUFFERSIZE, fp);
+    // clear out existing data
+    if (!append)
+    {
+      if (shapes) shapes->resize(0);
+      vertices.resize(0);
+    }
 
-    for(size_t p = 0; p <= buffer_size; ++p)
+    shapeno = shapes ? shapes->size() : 0;
+    firstvertexno = vertexno = lastvertexno = vertices.size();
+    vertex = Vertex(0,0,shapeno);
+  }
+
+  //! scan the characters in [p, end)
+  void feed(char const * p, char const * end)
+  {
+    char const * tokenstart = p; // a number continued from the last block starts here
+    for(; p != end; ++p)
     {
-      char c;
+      char c = *p;
+      unsigned digit = (unsigned char)c - '0';
 
-      if (buffer_size == 0)
+      if (digit < 10 || c == '-')
       {
-        newlines = 2;
-        c = 0;
-      }
-      else
-        c = buffer[p];
-      
-      bool is_whitespace = c <= 32;
-      bool is_num = isdigit(c) || c == '-';
-      bool is_line = c == '\n';
-      
-      if (is_num)
-        num += c;
-      else
-      {
-        if (num.length() > 0 || buffer_size == 0) // new field found
+        if (!intoken)
         {
-          if (newlines > 0)
+          // same conversion as atoi: optional sign, then digits up to
+          // the first character that isn't one
+          intoken = true;
+          tokenstart = p;
+          pending.resize(0);
+          negative = c == '-';
+          decoding = true;
+          value = negative ? 0 : digit;
+
+          // most numbers are plain digit runs, decode them right here
+          while (p + 1 != end && (digit = (unsigned char)p[1] - '0') < 10)
           {
-            if (vertexno != 0 || state == CRUFT) // ignore leading newlines
-            {  
-              if (state < CRUFT)
-                cerr << "Parse error on line " << lineno << ". Vertex " << vertexno << " has invalid x or y coordinates" << endl;
-              state = XCOORD;
-
-              // if the last vertex is the same as the first one, don't add it
-              if (newlines <= 1 || !vertex.equals(vertices[lastvertexno]))
-              {
-                vertices.push_back(vertex);
-                ++vertexno;
-              }
-
-              if (newlines > 1)
-              {
-                if (shapes) shapes->push_back(Shape(lastvertexno,vertexno - lastvertexno));
-                ++shapeno;
-                vertex.shapeno = shapeno;
-                lastvertexno = vertexno;
-              }
-            }  
-            newlines = 0;
+            value = value * 10 + digit;
+            ++p;
           }
-         
-          if (state == XCOORD)
-            vertex.x = atoi(num.c_str());
-          else if (state == YCOORD)
-            vertex.y = atoi(num.c_str());
+        }
+        else if (decoding)
+        {
+          if (digit < 10)
+            value = value * 10 + digit;
           else
-            cerr << "Cruft '" << num << "' found on line " << lineno << "." << endl;
-          
-          if (state < CRUFT) ++state;
-          num = "";
-        } // num.length() > 0
-        
-        if (is_line) { ++newlines; ++lineno; }
+            decoding = false;
+        }
+      }
+      else
+      {
+        if (intoken)
+          field(tokenstart, p);
+        if (c == '\n') { ++newlines; ++lineno; }
       }
-    } // for p
+    }
+
+    // a number runs off the end of this block, only its text needs saving
+    if (intoken && state == CRUFT)
+      pending.append(tokenstart, end);
+  }
+
+  //! end of input, close the last vertex and shape
+  void finish()
+  {
+    if (intoken) field(NULL, NULL);
+    newlines = 2;
+    separate();
+  }
+
+  //! save problems in d instead of printing them
+  void keepDiagnostics(vector<_World_readFile_diagnostic> * d)
+  {
+    diagnostics = d;
+  }
+
+  //! the input continues a file that already had vertices before it
+  void continueFile()
+  {
+    midfile = true;
+  }
+
+  //! a vertex was finished before any y coordinate was read, so it took its y from before the input
+  bool inheritedY() const
+  {
+    return yinherited;
+  }
+
+  //! newlines seen so far
+  int lines() const
+  {
+    return lineno - 1;
+  }
+
+private:
+  vector<PointType> & vertices;
+  vector<Shape> * shapes;
+
+  int shapeno;
+  int firstvertexno;
+  int vertexno;
+  int lastvertexno;
+  Vertex vertex;
+
+  enum { XCOORD, YCOORD, CRUFT };
+  int state;
+
+  int newlines;
+  int lineno;
+
+  // number being scanned
+  bool intoken;
+  bool negative;
+  bool decoding;
+  long value;
+  string pending;
+
+  vector<_World_readFile_diagnostic> * diagnostics;
+  bool midfile;
+  bool yread;
+  bool yinherited;
+
+  void report(_World_readFile_diagnostic const & d)
+  {
+    if (diagnostics)
+      diagnostics->push_back(d);
+    else
+      d.print();
+  }
+
+  //! handle newlines that came before the current field
+  void separate()
+  {
+    if (newlines > 0)
+    {
+      if (midfile || vertexno != firstvertexno || state == CRUFT) // ignore leading newlines
+      {
+        if (state < CRUFT)
+          report(_World_readFile_diagnostic(lineno, vertexno - firstvertexno));
+        state = XCOORD;
+        if (!yread) yinherited = true;
+
+        // if the last vertex is the same as the first one, don't add it
+        if (newlines <= 1 || vertexno == lastvertexno || !vertex.equals(vertices[lastvertexno]))
+        {
+          vertices.push_back(vertex);
+          ++vertexno;
+        }
+
+        if (newlines > 1)
+        {
+          if (shapes) shapes->push_back(Shape(lastvertexno,vertexno - lastvertexno));
+          ++shapeno;
+          vertex.shapeno = shapeno;
+          lastvertexno = vertexno;
+        }
+      }
+      newlines = 0;
+    }
+  }
+
+  //! store a completed number. [tokenstart, tokenend) is its text in the current block
+  void field(char const * tokenstart, char const * tokenend)
+  {
+    intoken = false;
+    separate();
+
+    World::coord n = (World::coord)(negative ? -value : value);
+    if (state == XCOORD)
+      vertex.x = n;
+    else if (state == YCOORD)
+    {
+      vertex.y = n;
+      yread = true;
+    }
+    else
+    {
+      if (tokenstart) pending.append(tokenstart, tokenend);
+      report(_World_readFile_diagnostic(lineno, -1, pending));
+    }
+
+    if (state < CRUFT) ++state;
+  }
+};
+
+template<typename PointType>
+void World::readFile(FILE * fp, vector<PointType> & vertices, vector<Shape> * shapes)
+{
+  _World_readFile_parser<PointType> parser(vertices, shapes);
+
+  const size_t BUFFERSIZE = 65536;
+  vector<char> buffer(BUFFERSIZE);
+  for(;;)
+  {
+    size_t buffer_size = fread(&buffer[0], sizeof(char), BUFFERSIZE, fp);
     if (buffer_size == 0) break;
+    parser.feed(&buffer[0], &buffer[0] + buffer_size);
   }
+  parser.finish();
+}
+
+template<typename PointType>
+void World::readFile(char const * filename, vector<PointType> & vertices, vector<Shape> * shapes)
+{
+  MappedFile file(filename);
+  if (workers && file.size() >= PARALLEL_PARSE_SIZE && readFileParallel(file, vertices, shapes))
+    return;
+
+  _World_readFile_parser<PointType> parser(vertices, shapes);
+  parser.feed(file.begin(), file.end());
+  parser.finish();
 }
 
 template<class InputIterator>
@@ -293,6 +616,7 @@ void World::outputShapes(FILE * fp, InputIterator istart, InputIterator iend)
 {
   if (istart == iend) return;
   
+  BufferedWriter out(fp);
   int lastshape = istart->shapeno;
   InputIterator firsti = istart;
   
@@ -302,16 +626,17 @@ void World::outputShapes(FILE * fp, InputIterator istart, InputIterator iend)
     
     if (over || lastshape != i->shapeno)
     {
-      fprintf(fp, "%i %i\n\n",firsti->x,firsti->y);
+      out << firsti->x << ' ' << firsti->y << "\n\n";
       firsti = i;
     }
    
     if (over) break;
     
-    fprintf(fp, "%i %i\n",i->x,i->y);
+    out << i->x << ' ' << i->y << '\n';
     
     lastshape = i->shapeno;
   }
+  out.flush();
 }
 
 #endif